@@ -0,0 +1,77 @@
+#include "Benchmark.h"
+
+#include "ECS.h"
+
+#include <random>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////
+// Archetype Benchmark
+////////////////////////////////////////////////////////////////////////////////
+// Compares iterating 3 to 6 component queries with views over per-type pools
+// (baseline) against the archetype storage backend (new). Half the entities
+// have all six components, the other half a random subset of them.
+////////////////////////////////////////////////////////////////////////////////
+template <int I>
+struct DataComponent {
+    float value = 1.0f;
+    float padding[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+template <int I>
+struct ComponentRegistry<DataComponent<I>> {
+    static constexpr bool registered = true;
+    static constexpr ComponentId id = I;
+    static constexpr const char *name = "DataComponent";
+};
+
+template <int ...Is>
+void addComponents(Coordinator &coordinator, Entity entity, unsigned mask, std::integer_sequence<int, Is...>) {
+    ((mask & (1u << Is) ? coordinator.addComponent<DataComponent<Is>>(entity) : void()), ...);
+}
+
+void populate(Coordinator &coordinator, size_t n) {
+    std::mt19937 random(42);
+    for (size_t i = 0; i < n; i++) {
+        const unsigned mask = i % 2 == 0 ? 0x3f : random() & 0x3f;
+        addComponents(coordinator, coordinator.create(), mask, std::make_integer_sequence<int, 6>());
+    }
+    coordinator.update();
+}
+
+template <int ...Is>
+float query(const Coordinator &coordinator, std::integer_sequence<int, Is...>) {
+    float sum = 0.0f;
+    coordinator.view<DataComponent<Is>...>().each([&sum](DataComponent<Is> &...components) {
+        sum += (components.value + ...);
+    });
+    return sum;
+}
+
+template <int K>
+void run(const Coordinator &pools, const Coordinator &archetypes, size_t n) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%d component query", K);
+    benchmark::report(name, n,
+        benchmark::measure([&]() { benchmark::doNotOptimize(query(pools, std::make_integer_sequence<int, K>())); }),
+        benchmark::measure([&]() { benchmark::doNotOptimize(query(archetypes, std::make_integer_sequence<int, K>())); })
+    );
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+
+    benchmark::header("Query iteration: per-type pools (baseline) vs archetype chunks (new)");
+    for (size_t n : { 10000, 100000, 1000000 }) {
+        Coordinator pools(StorageBackend::Pools);
+        Coordinator archetypes(StorageBackend::Archetypes);
+        populate(pools, n);
+        populate(archetypes, n);
+
+        run<3>(pools, archetypes, n);
+        run<4>(pools, archetypes, n);
+        run<5>(pools, archetypes, n);
+        run<6>(pools, archetypes, n);
+    }
+    return 0;
+}
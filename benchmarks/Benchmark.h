@@ -0,0 +1,54 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmark
+////////////////////////////////////////////////////////////////////////////////
+// Small helpers shared by the microbenchmarks. Each benchmark is a standalone
+// executable built by `make benchmark`.
+////////////////////////////////////////////////////////////////////////////////
+namespace benchmark {
+
+// Prevents the compiler from optimizing away a value that is never used.
+template <typename T>
+inline void doNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Runs the setup and body functions a number of times and returns the fastest
+// runtime of the body in milliseconds.
+template <typename TSetup, typename TBody>
+double measure(TSetup &&setup, TBody &&body, int repetitions = 5) {
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < repetitions; i++) {
+        setup();
+        const auto start = std::chrono::steady_clock::now();
+        body();
+        const auto stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+    return best;
+}
+
+template <typename TBody>
+double measure(TBody &&body, int repetitions = 5) {
+    return measure([]() {}, body, repetitions);
+}
+
+inline void header(const char *title) {
+    std::printf("\n%s\n", title);
+    std::printf("%-28s %10s %12s %12s %9s\n", "case", "n", "baseline ms", "new ms", "speedup");
+}
+
+inline void report(const char *name, size_t n, double baseline, double current) {
+    std::printf("%-28s %10zu %12.3f %12.3f %8.2fx\n", name, n, baseline, current, baseline / current);
+}
+
+}
+
+#endif
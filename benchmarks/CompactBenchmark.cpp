@@ -0,0 +1,65 @@
+#include "Benchmark.h"
+
+#include "ECS.h"
+#include "Components.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Compact Benchmark
+////////////////////////////////////////////////////////////////////////////////
+// Loads a level of entities with a transform, a rigid body and a health
+// component, unloads all but 1% of them and compacts the coordinator. Reports
+// the memory compact gives back and how long it takes, for both storage
+// backends.
+////////////////////////////////////////////////////////////////////////////////
+struct HealthComponent {
+    int health;
+};
+
+REGISTER_COMPONENT(HealthComponent, 2);
+
+class MovementSystem : public System {
+    public:
+        MovementSystem() {
+            requireComponent<TransformComponent>();
+            requireComponent<RigidBodyComponent>();
+        }
+};
+
+void loadAndUnloadLevel(Coordinator &coordinator, size_t n) {
+    const auto entities = coordinator.create(n);
+    coordinator.addComponents<TransformComponent, RigidBodyComponent, HealthComponent>(entities, [](Entity) {
+        return std::make_tuple(TransformComponent(), RigidBodyComponent(), HealthComponent{ 100 });
+    });
+    coordinator.update();
+    for (size_t i = 0; i < n; i++) {
+        if (i % 100 != 0) {
+            coordinator.destroy(entities[i]);
+        }
+    }
+    coordinator.update();
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+
+    std::printf("\nCompacting after unloading 99%% of a level\n");
+    std::printf("%-28s %10s %12s %12s\n", "backend", "n", "released MB", "compact ms");
+    for (auto backend : { StorageBackend::Pools, StorageBackend::Archetypes }) {
+        for (size_t n : { 100000, 1000000 }) {
+            std::unique_ptr<Coordinator> coordinator;
+            size_t releasedBytes = 0;
+            const auto milliseconds = benchmark::measure(
+                [&]() {
+                    coordinator = std::make_unique<Coordinator>(backend, 0);
+                    coordinator->addSystem<MovementSystem>();
+                    loadAndUnloadLevel(*coordinator, n);
+                },
+                [&]() { releasedBytes = coordinator->compact(); },
+                3
+            );
+            std::printf("%-28s %10zu %12.2f %12.3f\n",
+                backend == StorageBackend::Pools ? "pools" : "archetypes", n, releasedBytes / (1024.0 * 1024.0), milliseconds);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include "Benchmark.h"
+
+#include "ECS.h"
+
+#include <deque>
+
+////////////////////////////////////////////////////////////////////////////////
+// Destroy Benchmark
+////////////////////////////////////////////////////////////////////////////////
+// Simulates one second of spawning and destroying 50k bullets per second at
+// 60 frames per second, with every bullet belonging to 8 systems. Compares
+// the vector based system membership System used to have (baseline) against
+// the sparse set membership (new), for different numbers of live bullets.
+////////////////////////////////////////////////////////////////////////////////
+const size_t SYSTEM_COUNT = 8;
+const size_t BULLETS_PER_SECOND = 50000;
+const size_t FRAMES_PER_SECOND = 60;
+
+class LegacyMembership {
+    private:
+        std::vector<Entity> entities;
+
+    public:
+        void add(Entity entity) {
+            entities.push_back(entity);
+        }
+
+        void remove(Entity entity) {
+            entities.erase(
+                std::remove_if(
+                    entities.begin(),
+                    entities.end(),
+                    [&entity](Entity other) { return entity.getId() == other.getId(); }
+                ),
+                entities.end()
+            );
+        }
+};
+
+class SparseSetMembership {
+    private:
+        SparseSet entities;
+
+    public:
+        void add(Entity entity) {
+            entities.insert(entity);
+        }
+
+        void remove(Entity entity) {
+            entities.remove(entity);
+        }
+};
+
+template <typename TMembership>
+void simulate(size_t liveBullets) {
+    std::vector<TMembership> systems(SYSTEM_COUNT);
+    std::deque<Entity> bullets;
+    EntityId nextIndex = 0;
+
+    auto spawn = [&]() {
+        const Entity bullet(nextIndex++ % MAX_ENTITIES);
+        for (auto &system : systems) {
+            system.add(bullet);
+        }
+        bullets.push_back(bullet);
+    };
+
+    for (size_t i = 0; i < liveBullets; i++) {
+        spawn();
+    }
+
+    // Every frame the oldest bullets expire and the same number is spawned
+    const size_t bulletsPerFrame = BULLETS_PER_SECOND / FRAMES_PER_SECOND;
+    for (size_t frame = 0; frame < FRAMES_PER_SECOND; frame++) {
+        for (size_t i = 0; i < bulletsPerFrame; i++) {
+            const auto bullet = bullets.front();
+            bullets.pop_front();
+            for (auto &system : systems) {
+                system.remove(bullet);
+            }
+        }
+        for (size_t i = 0; i < bulletsPerFrame; i++) {
+            spawn();
+        }
+    }
+}
+
+int main() {
+    benchmark::header("One second of 50k bullets/s over 8 systems: vector (baseline) vs sparse set (new)");
+    for (size_t liveBullets : { 1000, 10000, 50000 }) {
+        benchmark::report("live bullets", liveBullets,
+            benchmark::measure([&]() { simulate<LegacyMembership>(liveBullets); }, 3),
+            benchmark::measure([&]() { simulate<SparseSetMembership>(liveBullets); }, 3)
+        );
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "Benchmark.h"
+
+#include "ECS.h"
+#include "Components.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Disable Benchmark
+////////////////////////////////////////////////////////////////////////////////
+// Pools 10k enemies and every frame takes half of them off the field and
+// brings them back on the next frame. Compares destroying and recreating them
+// with their components (baseline) against disabling and enabling them (new).
+////////////////////////////////////////////////////////////////////////////////
+const int FRAMES = 100;
+
+class MovementSystem : public System {
+    public:
+        MovementSystem() {
+            requireComponent<TransformComponent>();
+            requireComponent<RigidBodyComponent>();
+        }
+};
+
+Entity spawn(Coordinator &coordinator) {
+    auto entity = coordinator.create();
+    coordinator.addComponent<TransformComponent>(entity, glm::vec2(0, 0));
+    coordinator.addComponent<RigidBodyComponent>(entity, glm::vec2(1, 0));
+    return entity;
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+
+    benchmark::header("Toggling half of the enemies every frame: destroy/create (baseline) vs disable/enable (new)");
+    for (size_t n : { 1000, 10000 }) {
+        std::unique_ptr<Coordinator> coordinator;
+        std::vector<Entity> enemies;
+        auto setup = [&]() {
+            coordinator = std::make_unique<Coordinator>(StorageBackend::Pools, 0);
+            coordinator->addSystem<MovementSystem>();
+            enemies.clear();
+            for (size_t i = 0; i < n; i++) {
+                enemies.push_back(spawn(*coordinator));
+            }
+            coordinator->update();
+        };
+        benchmark::report("frames", n,
+            benchmark::measure(setup, [&]() {
+                for (int frame = 0; frame < FRAMES; frame++) {
+                    for (size_t i = frame % 2; i < n; i += 2) {
+                        coordinator->destroy(enemies[i]);
+                    }
+                    coordinator->update();
+                    for (size_t i = frame % 2; i < n; i += 2) {
+                        enemies[i] = spawn(*coordinator);
+                    }
+                    coordinator->update();
+                }
+            }),
+            benchmark::measure(setup, [&]() {
+                for (int frame = 0; frame < FRAMES; frame++) {
+                    for (size_t i = frame % 2; i < n; i += 2) {
+                        coordinator->disable(enemies[i]);
+                    }
+                    coordinator->update();
+                    for (size_t i = frame % 2; i < n; i += 2) {
+                        coordinator->enable(enemies[i]);
+                    }
+                    coordinator->update();
+                }
+            })
+        );
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "Benchmark.h"
+
+#include "ECS.h"
+#include "Components.h"
+
+#include <random>
+
+////////////////////////////////////////////////////////////////////////////////
+// Group Benchmark
+////////////////////////////////////////////////////////////////////////////////
+// Compares iterating transforms and rigid bodies with a view (baseline)
+// against an owning group of both pools (new). Every entity has a transform,
+// a random half of them also has a rigid body, so the two pools are not in
+// the same order.
+////////////////////////////////////////////////////////////////////////////////
+void integrate(TransformComponent &transform, RigidBodyComponent &rigidbody) {
+    const float deltaTime = 1.0f / 60.0f;
+    rigidbody.velocity += rigidbody.acceleration * deltaTime;
+    transform.position += rigidbody.velocity * deltaTime;
+}
+
+void populate(Coordinator &coordinator, size_t n) {
+    std::mt19937 random(42);
+    std::vector<Entity> entities;
+    for (size_t i = 0; i < n; i++) {
+        auto entity = coordinator.create();
+        coordinator.addComponent<TransformComponent>(entity, glm::vec2(i, i));
+        entities.push_back(entity);
+    }
+    std::shuffle(entities.begin(), entities.end(), random);
+    for (size_t i = 0; i < n / 2; i++) {
+        coordinator.addComponent<RigidBodyComponent>(entities[i], glm::vec2(1, 2), glm::vec2(0, -9.81));
+    }
+    coordinator.update();
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+
+    benchmark::header("Transform + RigidBody iteration: view (baseline) vs owning group (new)");
+    for (size_t n : { 10000, 100000, 1000000 }) {
+        Coordinator coordinator(StorageBackend::Pools, 0);
+        populate(coordinator, n);
+
+        const auto view = coordinator.view<TransformComponent, RigidBodyComponent>();
+        const auto group = coordinator.owningGroup<TransformComponent, RigidBodyComponent>();
+        benchmark::report("each", n,
+            benchmark::measure([&]() { view.each(integrate); }),
+            benchmark::measure([&]() { group.each(integrate); })
+        );
+    }
+    return 0;
+}
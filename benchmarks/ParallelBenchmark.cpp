@@ -0,0 +1,58 @@
+#include "Benchmark.h"
+
+#include "ECS.h"
+#include "Components.h"
+
+#include <cmath>
+#include <thread>
+
+////////////////////////////////////////////////////////////////////////////////
+// Parallel Benchmark
+////////////////////////////////////////////////////////////////////////////////
+// Compares a serial each (baseline) against parallelEach (new) over 500k
+// entities with a transform and a rigid body, for an increasing number of
+// threads.
+////////////////////////////////////////////////////////////////////////////////
+const size_t ENTITY_COUNT = 500000;
+
+void integrate(TransformComponent &transform, RigidBodyComponent &rigidbody) {
+    const double deltaTime = 1.0 / 60.0;
+    rigidbody.velocity += rigidbody.acceleration * static_cast<float>(deltaTime);
+    transform.position += rigidbody.velocity * static_cast<float>(deltaTime);
+    transform.rotation = std::atan2(rigidbody.velocity.y, rigidbody.velocity.x);
+}
+
+void populate(Coordinator &coordinator) {
+    for (size_t i = 0; i < ENTITY_COUNT; i++) {
+        auto entity = coordinator.create();
+        coordinator.addComponent<TransformComponent>(entity, glm::vec2(i, i));
+        coordinator.addComponent<RigidBodyComponent>(entity, glm::vec2(1, 2), glm::vec2(0, -9.81));
+    }
+    coordinator.update();
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+
+    const size_t hardwareThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < hardwareThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hardwareThreads);
+
+    benchmark::header("Per-entity integration: serial each (baseline) vs parallelEach (new)");
+    for (auto threads : threadCounts) {
+        Coordinator coordinator(StorageBackend::Pools, threads - 1);
+        populate(coordinator);
+        const auto view = coordinator.view<TransformComponent, RigidBodyComponent>();
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "%zu threads", threads);
+        benchmark::report(name, ENTITY_COUNT,
+            benchmark::measure([&]() { view.each(integrate); }),
+            benchmark::measure([&]() { view.parallelEach(coordinator.getThreadPool(), integrate); })
+        );
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include "Benchmark.h"
+
+#include "ECS.h"
+#include "Components.h"
+
+#include <numeric>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+// Legacy Pool
+////////////////////////////////////////////////////////////////////////////////
+// The hash map based pool that Pool<T> replaced, kept here as the baseline.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+class LegacyPool {
+    private:
+        std::vector<T> data;
+        int size;
+
+        std::unordered_map<int, int> entityIdToIndex;
+        std::unordered_map<int, int> indexToEntityId;
+
+    public:
+        LegacyPool(int capacity = 100) {
+            size = 0;
+            data.resize(capacity);
+        }
+
+        int getSize() const {
+            return size;
+        }
+
+        void set(int entityId, T object) {
+            if (entityIdToIndex.find(entityId) != entityIdToIndex.end()) {
+                int index = entityIdToIndex.at(entityId);
+                data[index] = object;
+            } else {
+                int index = size;
+                entityIdToIndex.emplace(entityId, index);
+                indexToEntityId.emplace(index, entityId);
+
+                if (index >= static_cast<int>(data.capacity())) {
+                    data.resize(size * 2);
+                }
+
+                data[index] = object;
+                size++;
+            }
+        }
+
+        void remove(int entityId) {
+            if (entityIdToIndex.find(entityId) == entityIdToIndex.end()) {
+                return;
+            }
+
+            int indexOfRemoved = entityIdToIndex.at(entityId);
+            int indexOfLast = size - 1;
+            data[indexOfRemoved] = data[indexOfLast];
+
+            int entityIdOfLast = indexToEntityId[indexOfLast];
+            entityIdToIndex[entityIdOfLast] = indexOfRemoved;
+            indexToEntityId[indexOfRemoved] = entityIdOfLast;
+
+            entityIdToIndex.erase(entityId);
+            indexToEntityId.erase(indexOfLast);
+
+            size--;
+        }
+
+        T &get(int entityId) {
+            return data[entityIdToIndex[entityId]];
+        }
+
+        T &operator [](int index) {
+            return data[index];
+        }
+};
+
+template <typename TPool>
+void fill(TPool &pool, const std::vector<int> &ids) {
+    for (auto id : ids) {
+        pool.set(id, TransformComponent(glm::vec2(id, id)));
+    }
+}
+
+template <typename TPool>
+float lookup(TPool &pool, const std::vector<int> &ids) {
+    float sum = 0.0f;
+    for (auto id : ids) {
+        sum += pool.get(id).position.x;
+    }
+    return sum;
+}
+
+template <typename TPool>
+float iterate(TPool &pool) {
+    float sum = 0.0f;
+    for (int i = 0; i < pool.getSize(); i++) {
+        sum += pool[i].position.x;
+    }
+    return sum;
+}
+
+template <typename TPool>
+void removeHalf(TPool &pool, const std::vector<int> &ids) {
+    for (size_t i = 0; i < ids.size() / 2; i++) {
+        pool.remove(ids[i]);
+    }
+}
+
+void run(size_t n) {
+    std::vector<int> ids(n);
+    std::iota(ids.begin(), ids.end(), 0);
+    std::vector<int> shuffled = ids;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(42));
+
+    std::unique_ptr<LegacyPool<TransformComponent>> legacy;
+    std::unique_ptr<Pool<TransformComponent>> pool;
+
+    auto resetLegacy = [&]() { legacy = std::make_unique<LegacyPool<TransformComponent>>(); };
+    auto resetPool = [&]() { pool = std::make_unique<Pool<TransformComponent>>(); };
+    auto fillLegacy = [&]() { resetLegacy(); fill(*legacy, ids); };
+    auto fillPool = [&]() { resetPool(); fill(*pool, ids); };
+
+    benchmark::report("set", n,
+        benchmark::measure(resetLegacy, [&]() { fill(*legacy, ids); }),
+        benchmark::measure(resetPool, [&]() { fill(*pool, ids); })
+    );
+
+    fillLegacy();
+    fillPool();
+    benchmark::report("get (random order)", n,
+        benchmark::measure([&]() { benchmark::doNotOptimize(lookup(*legacy, shuffled)); }),
+        benchmark::measure([&]() { benchmark::doNotOptimize(lookup(*pool, shuffled)); })
+    );
+
+    benchmark::report("iterate", n,
+        benchmark::measure([&]() { benchmark::doNotOptimize(iterate(*legacy)); }),
+        benchmark::measure([&]() { benchmark::doNotOptimize(iterate(*pool)); })
+    );
+
+    benchmark::report("remove half (random order)", n,
+        benchmark::measure(fillLegacy, [&]() { removeHalf(*legacy, shuffled); }),
+        benchmark::measure(fillPool, [&]() { removeHalf(*pool, shuffled); })
+    );
+}
+
+int main() {
+    benchmark::header("Pool<T>: hash map index (baseline) vs sparse set (new)");
+    for (size_t n : { 10000, 100000, 1000000 }) {
+        run(n);
+    }
+    return 0;
+}
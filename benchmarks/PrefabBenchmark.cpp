@@ -0,0 +1,68 @@
+#include "Benchmark.h"
+
+#include "ECS.h"
+#include "Components.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Prefab Benchmark
+////////////////////////////////////////////////////////////////////////////////
+// Spawns bullets with a transform, a rigid body and a damage component that
+// belong to two systems. Compares repeating the addComponent sequence for
+// every bullet (baseline) against instantiating a bullet prefab (new).
+////////////////////////////////////////////////////////////////////////////////
+struct DamageComponent {
+    int damage;
+};
+
+REGISTER_COMPONENT(DamageComponent, 2);
+
+class MovementSystem : public System {
+    public:
+        MovementSystem() {
+            requireComponent<TransformComponent>();
+            requireComponent<RigidBodyComponent>();
+        }
+};
+
+class DamageSystem : public System {
+    public:
+        DamageSystem() {
+            requireComponent<TransformComponent>();
+            requireComponent<DamageComponent>();
+        }
+};
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+
+    Prefab bullet;
+    bullet.addComponent<TransformComponent>(glm::vec2(0, 0));
+    bullet.addComponent<RigidBodyComponent>(glm::vec2(0, 500));
+    bullet.addComponent<DamageComponent>(DamageComponent{ 10 });
+
+    benchmark::header("Spawning bullets: addComponent per bullet (baseline) vs prefab (new)");
+    for (size_t n : { 1000, 10000, 100000 }) {
+        std::unique_ptr<Coordinator> coordinator;
+        auto setup = [&]() {
+            coordinator = std::make_unique<Coordinator>(StorageBackend::Pools, 0);
+            coordinator->addSystem<MovementSystem>();
+            coordinator->addSystem<DamageSystem>();
+        };
+        benchmark::report("spawn", n,
+            benchmark::measure(setup, [&]() {
+                for (size_t i = 0; i < n; i++) {
+                    auto entity = coordinator->create();
+                    coordinator->addComponent<TransformComponent>(entity, glm::vec2(0, 0));
+                    coordinator->addComponent<RigidBodyComponent>(entity, glm::vec2(0, 500));
+                    coordinator->addComponent<DamageComponent>(entity, DamageComponent{ 10 });
+                }
+                coordinator->update();
+            }),
+            benchmark::measure(setup, [&]() {
+                coordinator->instantiate(bullet, n);
+                coordinator->update();
+            })
+        );
+    }
+    return 0;
+}
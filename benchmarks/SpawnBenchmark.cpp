@@ -0,0 +1,87 @@
+#include "Benchmark.h"
+
+#include "ECS.h"
+#include "Components.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Spawn Benchmark
+////////////////////////////////////////////////////////////////////////////////
+// Spawns a wave of entities with a transform, a rigid body, a health and a
+// sprite component, and matches them against two systems. Compares creating
+// them one by one with addComponent (baseline) against create(n) and
+// addComponents (new).
+////////////////////////////////////////////////////////////////////////////////
+struct HealthComponent {
+    int health;
+
+    HealthComponent(int health = 100) : health(health) {}
+};
+
+struct SpriteComponent {
+    int textureId;
+    glm::vec2 size;
+
+    SpriteComponent(int textureId = 0, glm::vec2 size = glm::vec2(32, 32)) : textureId(textureId), size(size) {}
+};
+
+REGISTER_COMPONENT(HealthComponent, 2);
+REGISTER_COMPONENT(SpriteComponent, 3);
+
+class MovementSystem : public System {
+    public:
+        MovementSystem() {
+            requireComponent<TransformComponent>();
+            requireComponent<RigidBodyComponent>();
+        }
+};
+
+class RenderSystem : public System {
+    public:
+        RenderSystem() {
+            requireComponent<TransformComponent>();
+            requireComponent<SpriteComponent>();
+        }
+};
+
+void spawnOneByOne(Coordinator &coordinator, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        auto entity = coordinator.create();
+        coordinator.addComponent<TransformComponent>(entity, glm::vec2(i, i));
+        coordinator.addComponent<RigidBodyComponent>(entity, glm::vec2(1, 0));
+        coordinator.addComponent<HealthComponent>(entity, 100);
+        coordinator.addComponent<SpriteComponent>(entity, 1);
+    }
+    coordinator.update();
+}
+
+void spawnInBulk(Coordinator &coordinator, size_t n) {
+    const auto entities = coordinator.create(n);
+    coordinator.addComponents<TransformComponent, RigidBodyComponent, HealthComponent, SpriteComponent>(entities, [](Entity entity) {
+        return std::make_tuple(
+            TransformComponent(glm::vec2(entity.getIndex(), entity.getIndex())),
+            RigidBodyComponent(glm::vec2(1, 0)),
+            HealthComponent(100),
+            SpriteComponent(1)
+        );
+    });
+    coordinator.update();
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+
+    benchmark::header("Spawning entities with 4 components: one by one (baseline) vs bulk (new)");
+    for (size_t n : { 10000, 100000 }) {
+        std::unique_ptr<Coordinator> coordinator;
+        auto setup = [&]() {
+            coordinator = std::make_unique<Coordinator>(StorageBackend::Pools, 0);
+            coordinator->addSystem<MovementSystem>();
+            coordinator->addSystem<RenderSystem>();
+        };
+        benchmark::report("spawn", n,
+            benchmark::measure(setup, [&]() { spawnOneByOne(*coordinator, n); }),
+            benchmark::measure(setup, [&]() { spawnInBulk(*coordinator, n); })
+        );
+    }
+    return 0;
+}
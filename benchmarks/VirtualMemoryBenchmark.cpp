@@ -0,0 +1,74 @@
+#include "Benchmark.h"
+
+#include "ECS.h"
+
+#include <glm/glm.hpp>
+
+////////////////////////////////////////////////////////////////////////////////
+// Virtual Memory Benchmark
+////////////////////////////////////////////////////////////////////////////////
+// Spawns particles into a pool at 10k per frame until it holds 1M of them and
+// compares the slowest frame of a vector backed pool (baseline) against a
+// pool reserved with RESERVE_COMPONENT_POOL (new). The slowest frames of the
+// baseline are the ones where the vector doubles and copies every particle.
+////////////////////////////////////////////////////////////////////////////////
+const size_t PARTICLE_COUNT = 1000000;
+const size_t PARTICLES_PER_FRAME = 10000;
+
+struct HeapParticle {
+    glm::vec2 position;
+    glm::vec2 velocity;
+    glm::vec4 color;
+    float life;
+
+    HeapParticle(float x, float y) : position(x, y), velocity(0, 1), color(1), life(1) {}
+};
+
+struct ReservedParticle : HeapParticle {
+    using HeapParticle::HeapParticle;
+};
+
+RESERVE_COMPONENT_POOL(ReservedParticle);
+
+template <typename TParticle>
+double getSlowestFrame() {
+    Pool<TParticle> pool;
+    double slowestFrame = 0;
+    for (size_t frame = 0; frame < PARTICLE_COUNT / PARTICLES_PER_FRAME; frame++) {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = frame * PARTICLES_PER_FRAME; i < (frame + 1) * PARTICLES_PER_FRAME; i++) {
+            pool.emplace(Entity(static_cast<EntityId>(i)), 0, static_cast<float>(i), 0.0f);
+        }
+        const auto stop = std::chrono::steady_clock::now();
+        slowestFrame = std::max(slowestFrame, std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+    benchmark::doNotOptimize(pool.getData());
+    return slowestFrame;
+}
+
+template <typename TParticle>
+void fill() {
+    Pool<TParticle> pool;
+    for (size_t i = 0; i < PARTICLE_COUNT; i++) {
+        pool.emplace(Entity(static_cast<EntityId>(i)), 0, static_cast<float>(i), 0.0f);
+    }
+    benchmark::doNotOptimize(pool.getData());
+}
+
+int main() {
+    benchmark::header("Pool growth to 1M particles: vector (baseline) vs reserved virtual memory (new)");
+
+    double baseline = std::numeric_limits<double>::max();
+    double current = std::numeric_limits<double>::max();
+    for (int i = 0; i < 3; i++) {
+        baseline = std::min(baseline, getSlowestFrame<HeapParticle>());
+        current = std::min(current, getSlowestFrame<ReservedParticle>());
+    }
+    benchmark::report("slowest frame", PARTICLES_PER_FRAME, baseline, current);
+
+    benchmark::report("total", PARTICLE_COUNT,
+        benchmark::measure([]() { fill<HeapParticle>(); }, 3),
+        benchmark::measure([]() { fill<ReservedParticle>(); }, 3)
+    );
+    return 0;
+}
@@ -1,6 +1,8 @@
 #ifndef COMPONENTS_H
 #define COMPONENTS_H
 
+#include "ECS.h"
+
 #include <glm/glm.hpp>
 
 struct TransformComponent {
@@ -15,6 +17,8 @@ struct TransformComponent {
     }
 };
 
+REGISTER_COMPONENT(TransformComponent, 0);
+
 struct RigidBodyComponent {
     glm::vec2 velocity = glm::vec2(0);
     glm::vec2 acceleration = glm::vec2(0);
@@ -27,4 +31,6 @@ struct RigidBodyComponent {
     }
 };
 
+REGISTER_COMPONENT(RigidBodyComponent, 1);
+
 #endif
\ No newline at end of file
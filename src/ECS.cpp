@@ -4,42 +4,375 @@
 #include <iostream>
 
 ////////////////////////////////////////////////////////////////////////////////
-// Initialize static members
+// Archetype
 ////////////////////////////////////////////////////////////////////////////////
-ComponentId IComponent::nextId = 0;
+static size_t alignUp(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+Archetype::Archetype(const ComponentSignature &signature, const std::vector<ComponentInfo> &componentInfos) {
+    this->signature = signature;
+    this->size = 0;
+
+    size_t rowBytes = sizeof(Entity);
+    for (ComponentId componentId = 0; componentId < componentInfos.size(); componentId++) {
+        // Tags are part of the signature, but have no column
+        if (signature.test(componentId) && componentInfos[componentId].size > 0) {
+            columnPerComponentId.resize(componentId + 1, -1);
+            columnPerComponentId[componentId] = static_cast<int>(columns.size());
+            columns.push_back({ componentId, 0, componentInfos[componentId] });
+            rowBytes += componentInfos[componentId].size;
+        }
+    }
+
+    // Lay out the entity id column followed by one aligned column per component
+    auto layout = [this](size_t capacity) {
+        size_t offset = capacity * sizeof(Entity);
+        for (auto &column : columns) {
+            offset = alignUp(offset, column.info.alignment);
+            column.offset = offset;
+            offset += capacity * column.info.size;
+        }
+        return offset;
+    };
+
+    // Fit as many rows as possible into a chunk, but always at least one
+    chunkCapacity = std::max<size_t>(1, CHUNK_SIZE / rowBytes);
+    chunkBytes = layout(chunkCapacity);
+    while (chunkBytes > CHUNK_SIZE && chunkCapacity > 1) {
+        chunkBytes = layout(--chunkCapacity);
+    }
+    chunkBytes = std::max(chunkBytes, CHUNK_SIZE);
+}
+
+Archetype::~Archetype() {
+    for (size_t row = 0; row < size; row++) {
+        for (const auto &column : columns) {
+            column.info.destroy(getSlot(row, column));
+        }
+    }
+}
+
+size_t Archetype::allocate(Entity entity) {
+    const auto row = size;
+    if (row / chunkCapacity >= chunks.size()) {
+        auto chunk = static_cast<std::byte *>(::operator new(chunkBytes, std::align_val_t(CHUNK_ALIGNMENT)));
+        chunks.emplace_back(chunk);
+    }
+    getEntities(row / chunkCapacity)[row % chunkCapacity] = entity;
+    size++;
+    return row;
+}
+
+void Archetype::moveFrom(Archetype &source, size_t sourceRow, size_t row) {
+    for (const auto &column : columns) {
+        if (source.hasColumn(column.componentId)) {
+            column.info.moveConstruct(getSlot(row, column), source.getComponent(sourceRow, column.componentId));
+        }
+    }
+}
+
+size_t Archetype::shrinkToFit() {
+    const auto freedBytes = getUnusedBytes();
+    if (freedBytes > 0) {
+        chunks.resize(GROWTH_SLACK * getChunkCount());
+        chunks.shrink_to_fit();
+    }
+    return freedBytes;
+}
+
+std::optional<Entity> Archetype::remove(size_t row) {
+    const auto last = size - 1;
+    for (const auto &column : columns) {
+        column.info.destroy(getSlot(row, column));
+        if (row != last) {
+            column.info.moveConstruct(getSlot(row, column), getSlot(last, column));
+            column.info.destroy(getSlot(last, column));
+        }
+    }
+    size--;
+
+    if (row == last) {
+        return std::nullopt;
+    }
+    const auto movedEntity = getEntity(last);
+    getEntities(row / chunkCapacity)[row % chunkCapacity] = movedEntity;
+    return movedEntity;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Archetype Storage
+////////////////////////////////////////////////////////////////////////////////
+Archetype *ArchetypeStorage::getArchetype(const ComponentSignature &signature) {
+    // Entities without any components are not stored in an archetype
+    if (signature.none()) {
+        return nullptr;
+    }
+
+    auto &archetype = archetypesPerSignature[signature];
+    if (!archetype) {
+        archetype = std::make_unique<Archetype>(signature, componentInfos);
+        archetypes.push_back(archetype.get());
+    }
+    return archetype.get();
+}
+
+Archetype *ArchetypeStorage::getArchetypeWith(Archetype *archetype, ComponentId componentId) {
+    if (!archetype) {
+        ComponentSignature signature;
+        signature.set(componentId);
+        return getArchetype(signature);
+    }
+
+    auto edge = archetype->addEdges.find(componentId);
+    if (edge != archetype->addEdges.end()) {
+        return edge->second;
+    }
+
+    auto signature = archetype->getSignature();
+    signature.set(componentId);
+    auto destination = getArchetype(signature);
+    archetype->addEdges[componentId] = destination;
+    destination->removeEdges[componentId] = archetype;
+    return destination;
+}
+
+Archetype *ArchetypeStorage::getArchetypeWithout(Archetype *archetype, ComponentId componentId) {
+    auto edge = archetype->removeEdges.find(componentId);
+    if (edge != archetype->removeEdges.end()) {
+        return edge->second;
+    }
+
+    auto signature = archetype->getSignature();
+    signature.reset(componentId);
+    auto destination = getArchetype(signature);
+    archetype->removeEdges[componentId] = destination;
+    if (destination) {
+        destination->addEdges[componentId] = archetype;
+    }
+    return destination;
+}
+
+void ArchetypeStorage::move(Entity entity, Archetype *destination) {
+    auto &location = locations[entity.getIndex()];
+    auto source = location.archetype;
+    const auto sourceRow = location.row;
+
+    size_t row = 0;
+    if (destination) {
+        row = destination->allocate(entity);
+        if (source) {
+            destination->moveFrom(*source, sourceRow, row);
+        }
+    }
+
+    // Fill the hole left in the source archetype with its last row
+    if (source) {
+        auto movedEntity = source->remove(sourceRow);
+        if (movedEntity) {
+            locations[movedEntity->getIndex()].row = sourceRow;
+        }
+    }
+
+    location.archetype = destination;
+    location.row = row;
+}
+
+void ArchetypeStorage::destroy(Entity entity) {
+    if (entity.getIndex() < locations.size() && locations[entity.getIndex()].archetype) {
+        move(entity, nullptr);
+    }
+}
+
+size_t ArchetypeStorage::getUnusedBytes() const {
+    size_t unusedBytes = ::getUnusedBytes(locations);
+    for (auto archetype : archetypes) {
+        unusedBytes += archetype->getUnusedBytes();
+    }
+    return unusedBytes;
+}
+
+size_t ArchetypeStorage::shrinkToFit(size_t entityCount) {
+    size_t freedBytes = 0;
+    for (auto archetype : archetypes) {
+        freedBytes += archetype->shrinkToFit();
+    }
+    if (entityCount < locations.size()) {
+        locations.resize(entityCount);
+    }
+    return freedBytes + releaseUnusedCapacity(locations);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Owning Group
+////////////////////////////////////////////////////////////////////////////////
+OwningGroupData::OwningGroupData(const ComponentSignature &ownedSignature, const ComponentSignature &signature, std::vector<IPool *> ownedPools) {
+    this->ownedSignature = ownedSignature;
+    this->signature = signature;
+    this->ownedPools = std::move(ownedPools);
+    this->size = 0;
+}
+
+bool OwningGroupData::contains(Entity entity) const {
+    const auto &entities = ownedPools.front()->getEntities();
+    return entities.contains(entity) && entities.indexOf(entity) < size;
+}
+
+void OwningGroupData::onComponentAdded(Entity entity, const ComponentSignature &entitySignature) {
+    // Disabled entities stay after the group until they are enabled again
+    if (!entitySignature.contains(signature) || entitySignature.intersects(DISABLED_SIGNATURE) || contains(entity)) {
+        return;
+    }
+
+    // Swap the entity with the first entity after the group in every owned pool
+    for (auto pool : ownedPools) {
+        pool->swap(pool->getEntities().indexOf(entity), size);
+    }
+    size++;
+}
+
+void OwningGroupData::onComponentRemoved(Entity entity) {
+    if (!contains(entity)) {
+        return;
+    }
+
+    // Swap the entity with the last entity of the group in every owned pool
+    size--;
+    for (auto pool : ownedPools) {
+        pool->swap(pool->getEntities().indexOf(entity), size);
+    }
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // System
 ////////////////////////////////////////////////////////////////////////////////
+void System::reserve(size_t n) {
+    entities.reserve(n);
+}
+
 void System::addEntityToSystem(Entity entity) {
-    entities.push_back(entity);
+    if (!entities.contains(entity)) {
+        entities.insert(entity);
+    }
 }
 
 void System::removeEntityToSystem(Entity entity) {
-    entities.erase(
-        std::remove_if(
-            entities.begin(),
-            entities.end(),
-            [&entity](Entity other) {
-                return entity.getId() == other.getId();
-            }
-        ),
-        entities.end()
-    );
+    if (entities.contains(entity)) {
+        entities.remove(entity);
+    }
+}
+
+bool System::hasEntity(Entity entity) const {
+    return entities.contains(entity);
 }
 
-std::vector<Entity> System::getSystemEntities() const {
+const SparseSet &System::getSystemEntities() const {
     return entities;
 }
 
-const ComponentSignature System::getComponentSignature() const {
+size_t System::shrinkToFit() {
+    return entities.shrinkToFit();
+}
+
+const ComponentSignature &System::getComponentSignature() const {
     return componentSignature;
 }
 
+const ComponentSignature &System::getExcludeSignature() const {
+    return excludeSignature;
+}
+
+const ComponentSignature &System::getReadSignature() const {
+    return readSignature;
+}
+
+const ComponentSignature &System::getWriteSignature() const {
+    return writeSignature;
+}
+
+bool System::matches(const ComponentSignature &signature) const {
+    return signature.contains(componentSignature) && !signature.intersects(excludeSignature);
+}
+
+bool System::isAffectedBy(const ComponentSignature &changedBits) const {
+    return changedBits.intersects(componentSignature) || changedBits.intersects(excludeSignature);
+}
+
+bool System::conflictsWith(const System &other) const {
+    if (!hasDeclaredAccess || !other.hasDeclaredAccess) {
+        return true;
+    }
+    return (
+        writeSignature.intersects(other.readSignature | other.writeSignature)
+        ||
+        other.writeSignature.intersects(readSignature)
+    );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Command Buffer
+////////////////////////////////////////////////////////////////////////////////
+CommandBuffer::CommandBuffer(Coordinator &coordinator) : coordinator(coordinator) {
+    currentBlock = 0;
+    blockOffset = 0;
+}
+
+CommandBuffer::~CommandBuffer() {
+    clear();
+}
+
+void *CommandBuffer::allocate(size_t size, size_t alignment) {
+    // Move on to the next block if the object does not fit in the current one
+    blockOffset = alignUp(blockOffset, alignment);
+    if (currentBlock < blocks.size() && blockOffset + size > blockSizes[currentBlock]) {
+        currentBlock++;
+        blockOffset = 0;
+    }
+    while (currentBlock < blocks.size() && size > blockSizes[currentBlock]) {
+        currentBlock++;
+    }
+    if (currentBlock == blocks.size()) {
+        const auto blockSize = std::max(BLOCK_SIZE, size);
+        blocks.push_back(std::make_unique<std::byte[]>(blockSize));
+        blockSizes.push_back(blockSize);
+    }
+
+    auto object = blocks[currentBlock].get() + blockOffset;
+    blockOffset += size;
+    return object;
+}
+
+Entity CommandBuffer::create() {
+    const auto entity = coordinator.reserve();
+    commands.push_back({ CommandType::Create, entity, nullptr, nullptr, nullptr });
+    return entity;
+}
+
+void CommandBuffer::destroy(Entity entity) {
+    commands.push_back({ CommandType::Destroy, entity, nullptr, nullptr, nullptr });
+}
+
+void CommandBuffer::clear() {
+    for (auto &command : commands) {
+        if (command.destroy) {
+            command.destroy(command.component);
+        }
+    }
+    commands.clear();
+    currentBlock = 0;
+    blockOffset = 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Coordinator
 ////////////////////////////////////////////////////////////////////////////////
-Coordinator::Coordinator() {
+Coordinator::Coordinator(StorageBackend storageBackend, size_t workerCount) : threadPool(workerCount) {
+    this->storageBackend = storageBackend;
+
+    for (size_t i = 0; i < threadPool.getThreadCount(); i++) {
+        commandBuffers.push_back(std::make_unique<CommandBuffer>(*this));
+    }
+
     spdlog::info("Coordinator constructor called.");
 }
 
@@ -48,211 +381,822 @@ Coordinator::~Coordinator() {
 }
 
 Entity Coordinator::create() {
-    EntityId entityId;
+    EntityId entityIndex;
 
+    std::unique_lock<std::mutex> lock(freeIdsMutex);
     if (freeIds.empty()) {
-        entityId = numEntites++;
-        if (entityId >= entityComponentSignatures.size()) {
-            int newSize = entityComponentSignatures.size() == 0 ? 2 : 2 * entityComponentSignatures.size();
-            entityComponentSignatures.resize(newSize);
-        }
+        lock.unlock();
+        entityIndex = takeFreshIndices(1);
+        assureEntitySlots(entityIndex);
     } else {
-        entityId = freeIds.front();
+        entityIndex = freeIds.front();
         freeIds.pop_front();
+        lock.unlock();
+        // The slot may have been released by compact
+        assureEntitySlots(entityIndex);
     }
 
-    Entity entity(entityId);
-    entitiesToBeCreated.insert(entity);
+    Entity entity(entityIndex, entityGenerations[entityIndex]);
+    entitiesToBeCreated.push_back(entity);
+    entityFlags[entityIndex] |= ENTITY_PENDING_SYNC | ENTITY_ALIVE;
 
-    spdlog::info("Entity created with id = " + std::to_string(entityId));
+    spdlog::debug("Entity created with id = {}", entity.getId());
 
     return entity;
 }
 
+EntityRange Coordinator::reserveRange(size_t n) {
+    std::vector<Entity> entities;
+    entities.reserve(n);
+
+    // Reuse free indices first, otherwise spawning and destroying in bulk
+    // would run out of entity indices. The fresh indices for the rest are
+    // taken before any free index, so that running out loses none of them.
+    std::unique_lock<std::mutex> lock(freeIdsMutex);
+    const auto reusedCount = std::min(n, freeIds.size());
+    const auto freshCount = n - reusedCount;
+    const auto firstFresh = freshCount > 0 ? takeFreshIndices(freshCount) : 0;
+    for (size_t i = 0; i < reusedCount; i++) {
+        const auto entityIndex = freeIds.front();
+        freeIds.pop_front();
+        entities.push_back(Entity(entityIndex, entityGenerations[entityIndex]));
+    }
+    lock.unlock();
+    // The slots may have been released by compact
+    for (auto entity : entities) {
+        assureEntitySlots(entity.getIndex());
+    }
+
+    if (freshCount > 0) {
+        assureEntitySlots(static_cast<EntityId>(firstFresh + freshCount - 1));
+        for (size_t i = 0; i < freshCount; i++) {
+            const auto entityIndex = static_cast<EntityId>(firstFresh + i);
+            entities.push_back(Entity(entityIndex, entityGenerations[entityIndex]));
+        }
+    }
+
+    for (auto entity : entities) {
+        entityFlags[entity.getIndex()] |= ENTITY_PENDING_SYNC | ENTITY_ALIVE;
+    }
+    return EntityRange(std::move(entities));
+}
+
+EntityRange Coordinator::create(size_t n) {
+    const auto entities = reserveRange(n);
+    entitiesToBeCreated.reserve(entitiesToBeCreated.size() + n);
+    for (auto entity : entities) {
+        entitiesToBeCreated.push_back(entity);
+    }
+
+    spdlog::debug("{} entities created", n);
+
+    return entities;
+}
+
+EntityRange Coordinator::instantiate(const Prefab &prefab, size_t n) {
+    const auto entities = reserveRange(n);
+    if (n == 0) {
+        return entities;
+    }
+
+    for (const auto &prefabComponent : prefab.components) {
+        prefabComponent.instantiate(*this, prefabComponent.component.get(), entities);
+    }
+
+    // Archetype storage already set the component bits while adding
+    if (storageBackend == StorageBackend::Pools) {
+        for (auto entity : entities) {
+            entityComponentSignatures[entity.getIndex()] = prefab.getSignature();
+        }
+        if (!owningGroups.empty()) {
+            for (auto entity : entities) {
+                addToOwningGroups(entity, prefab.getSignature());
+            }
+        }
+    }
+
+    prefabInstancesToBeCreated.push_back({ entities, prefab.getSignature() });
+
+    spdlog::debug("{} prefab instances created", n);
+
+    return entities;
+}
+
 void Coordinator::destroy(Entity entity) {
-    entitiesToBeDestroyed.insert(entity);
+    entitiesToBeDestroyed.push_back(entity);
+}
+
+bool Coordinator::isAlive(Entity entity) const {
+    // Indices reserved by a command buffer that was not played back yet
+    // may have no slot yet, and are not alive until they are created
+    const auto entityIndex = entity.getIndex();
+    if (entityIndex >= entityFlags.size() || !(entityFlags[entityIndex] & ENTITY_ALIVE)) {
+        return false;
+    }
+    return entityGenerations[entityIndex] == entity.getGeneration();
+}
+
+void Coordinator::disable(Entity entity) {
+    if (!isEnabled(entity)) {
+        return;
+    }
+
+    if (storageBackend == StorageBackend::Archetypes) {
+        archetypes.add<Disabled>(entity);
+    } else {
+        // Leave the owning groups, so that their dense ranges only hold
+        // enabled entities
+        removeFromOwningGroups(entity, entityComponentSignatures[entity.getIndex()]);
+    }
+    setComponentBit(entity, Component<Disabled>::getId(), true);
+    disabledEntityCount++;
+    spdlog::debug("Entity {} was disabled", entity.getIndex());
+}
+
+void Coordinator::enable(Entity entity) {
+    // Ignore stale handles, the slot may belong to another entity by now
+    if (!isAlive(entity) || isEnabled(entity)) {
+        return;
+    }
+
+    setComponentBit(entity, Component<Disabled>::getId(), false);
+    if (storageBackend == StorageBackend::Archetypes) {
+        archetypes.remove<Disabled>(entity);
+    } else {
+        addToOwningGroups(entity, entityComponentSignatures[entity.getIndex()]);
+    }
+    disabledEntityCount--;
+    spdlog::debug("Entity {} was enabled", entity.getIndex());
+}
+
+bool Coordinator::isEnabled(Entity entity) const {
+    if (!isAlive(entity)) {
+        return false;
+    }
+    return !entityComponentSignatures[entity.getIndex()].intersects(DISABLED_SIGNATURE);
+}
+
+Entity Coordinator::reserve() {
+    // NOTE: The slot of a reused index is assured when the command buffer is
+    // played back. Generations only change in update, while no system runs.
+    {
+        std::lock_guard<std::mutex> lock(freeIdsMutex);
+        if (!freeIds.empty()) {
+            const auto entityIndex = freeIds.front();
+            freeIds.pop_front();
+            return Entity(entityIndex, entityGenerations[entityIndex]);
+        }
+    }
+
+    // A fresh index still has its first generation
+    return Entity(takeFreshIndices(1), 0);
+}
+
+EntityId Coordinator::takeFreshIndices(size_t n) {
+    // Never move past MAX_ENTITIES, so the handed out indices stay valid
+    // after a failed attempt
+    auto first = numEntites.load();
+    do {
+        if (n > MAX_ENTITIES - first) {
+            throw std::length_error("Too many entities for the entity index bits");
+        }
+    } while (!numEntites.compare_exchange_weak(first, static_cast<EntityId>(first + n)));
+    return first;
+}
+
+CommandBuffer &Coordinator::getCommandBuffer() {
+    const auto threadIndex = ThreadPool::getCurrentThreadIndex();
+    assert(threadIndex < commandBuffers.size() && "Thread does not belong to the coordinator's thread pool");
+    return *commandBuffers[threadIndex];
+}
+
+void Coordinator::assureEntitySlots(EntityId entityIndex) {
+    if (entityIndex >= MAX_ENTITIES) {
+        throw std::length_error("Too many entities for the entity index bits");
+    }
+    if (entityIndex >= entityComponentSignatures.size()) {
+        size_t newSize = entityComponentSignatures.size() == 0 ? 2 : 2 * entityComponentSignatures.size();
+        newSize = std::max<size_t>(newSize, entityIndex + 1);
+        entityComponentSignatures.resize(newSize);
+        // Generations are never released, see shrinkEntitySlots
+        entityGenerations.resize(std::max(entityGenerations.size(), newSize), 0);
+        entityFlags.resize(newSize, 0);
+        groupsPerEntity.resize(newSize);
+        tagPerEntity.resize(newSize, NULL_TAG);
+    }
+}
+
+void Coordinator::addToOwningGroups(Entity entity, ComponentId componentId) {
+    for (auto &group : owningGroups) {
+        if (group->getSignature().test(componentId)) {
+            group->onComponentAdded(entity, entityComponentSignatures[entity.getIndex()]);
+        }
+    }
+}
+
+void Coordinator::addToOwningGroups(Entity entity, const ComponentSignature &addedComponents) {
+    for (auto &group : owningGroups) {
+        if (group->getSignature().intersects(addedComponents)) {
+            group->onComponentAdded(entity, entityComponentSignatures[entity.getIndex()]);
+        }
+    }
+}
+
+void Coordinator::removeFromOwningGroups(Entity entity, const ComponentSignature &removedComponents) {
+    for (auto &group : owningGroups) {
+        if (group->getSignature().intersects(removedComponents)) {
+            group->onComponentRemoved(entity);
+        }
+    }
+}
+
+void Coordinator::setComponentBit(Entity entity, ComponentId componentId, bool value) {
+    const auto entityIndex = entity.getIndex();
+    auto &signature = entityComponentSignatures[entityIndex];
+    if (signature.test(componentId) == value) {
+        return;
+    }
+
+    // Remember the signature from before the first change since the last update
+    if (!(entityFlags[entityIndex] & ENTITY_PENDING_SYNC)) {
+        entityFlags[entityIndex] |= ENTITY_PENDING_SYNC;
+        signatureChanges.push_back({ entity, signature });
+    }
+    signature.set(componentId, value);
+}
+
+void Coordinator::addComponentBits(Entity entity, const ComponentSignature &componentBits) {
+    const auto entityIndex = entity.getIndex();
+    auto &signature = entityComponentSignatures[entityIndex];
+
+    // Remember the signature from before the first change since the last update
+    if (!(entityFlags[entityIndex] & ENTITY_PENDING_SYNC) && !signature.contains(componentBits)) {
+        entityFlags[entityIndex] |= ENTITY_PENDING_SYNC;
+        signatureChanges.push_back({ entity, signature });
+    }
+    signature |= componentBits;
+}
+
+void Coordinator::syncSignatureChanges() {
+    for (const auto &change : signatureChanges) {
+        const auto entityIndex = change.entity.getIndex();
+        entityFlags[entityIndex] &= ~ENTITY_PENDING_SYNC;
+        if (!isAlive(change.entity)) {
+            continue;
+        }
+
+        // Only systems that care about one of the changed bits can gain or
+        // lose the entity
+        const auto &signature = entityComponentSignatures[entityIndex];
+        const auto changedBits = signature ^ change.previousSignature;
+        for (auto &system : systemsInOrder) {
+            if (!system->isAffectedBy(changedBits)) {
+                continue;
+            }
+
+            bool wasInterested = system->matches(change.previousSignature);
+            bool isInterested = system->matches(signature);
+            if (isInterested && !wasInterested) {
+                system->addEntityToSystem(change.entity);
+            } else if (wasInterested && !isInterested) {
+                system->removeEntityToSystem(change.entity);
+            }
+        }
+    }
+    signatureChanges.clear();
+}
+
+void Coordinator::addEntitiesToSystem(System &system) {
+    const auto entityCount = std::min<size_t>(numEntites, entityComponentSignatures.size());
+    std::vector<Entity> matchingEntities;
+
+    // Entities whose signature did not change since they were last matched
+    forEachMatchingSignature(entityComponentSignatures.data(), entityCount, system.getComponentSignature(), [&](size_t entityIndex) {
+        if ((entityFlags[entityIndex] & (ENTITY_IN_SYSTEMS | ENTITY_PENDING_SYNC)) != ENTITY_IN_SYSTEMS) {
+            return;
+        }
+        if (!system.getExcludeSignature().intersects(entityComponentSignatures[entityIndex])) {
+            matchingEntities.push_back(Entity(entityIndex, entityGenerations[entityIndex]));
+        }
+    });
+
+    // Entities whose signature changed are matched with the signature the
+    // other systems saw, the next update syncs them like for every system
+    for (const auto &change : signatureChanges) {
+        if (isAlive(change.entity) && system.matches(change.previousSignature)) {
+            matchingEntities.push_back(change.entity);
+        }
+    }
+
+    system.reserve(matchingEntities.size());
+    for (auto entity : matchingEntities) {
+        system.addEntityToSystem(entity);
+    }
+}
+
+void Coordinator::playbackCommandBuffers() {
+    // Gather the commands of all threads and sort them by entity, keeping the
+    // recorded order of the commands of every entity. The command that
+    // creates an entity comes first, even if another thread recorded
+    // commands for the entity into a buffer that is played back earlier.
+    std::vector<const CommandBuffer::Command *> commands;
+    for (const auto &commandBuffer : commandBuffers) {
+        for (const auto &command : commandBuffer->getCommands()) {
+            commands.push_back(&command);
+        }
+    }
+    if (commands.empty()) {
+        return;
+    }
+    std::stable_sort(commands.begin(), commands.end(), [](auto *a, auto *b) {
+        if (a->entity.getIndex() != b->entity.getIndex()) {
+            return a->entity.getIndex() < b->entity.getIndex();
+        }
+        return a->type == CommandBuffer::CommandType::Create && b->type != CommandBuffer::CommandType::Create;
+    });
+
+    for (auto command : commands) {
+        switch (command->type) {
+            case CommandBuffer::CommandType::Create:
+                assureEntitySlots(command->entity.getIndex());
+                entitiesToBeCreated.push_back(command->entity);
+                entityFlags[command->entity.getIndex()] |= ENTITY_PENDING_SYNC | ENTITY_ALIVE;
+                break;
+            case CommandBuffer::CommandType::Destroy:
+                destroy(command->entity);
+                break;
+            case CommandBuffer::CommandType::AddComponent:
+            case CommandBuffer::CommandType::RemoveComponent:
+                if (isAlive(command->entity)) {
+                    command->apply(*this, command->entity, command->component);
+                }
+                break;
+        }
+    }
+
+    for (auto &commandBuffer : commandBuffers) {
+        commandBuffer->clear();
+    }
 }
 
 void Coordinator::addEntityToSystems(Entity entity) {
-    const auto entityId = entity.getId();
+    const auto entityIndex = entity.getIndex();
 
-    spdlog::info("added entity to system " + std::to_string(entityId));
-    if (entityId >= entityComponentSignatures.size()) {
+    spdlog::debug("Added entity {} to the systems", entity.getId());
+    if (entityIndex >= entityComponentSignatures.size()) {
         return;
     }
 
-    const auto entityComponentSignature = entityComponentSignatures[entityId];
+    const auto &entityComponentSignature = entityComponentSignatures[entityIndex];
+    entityFlags[entityIndex] |= ENTITY_IN_SYSTEMS;
 
     for (auto &system : systems) {
-        const auto systemComponentSignature = system.second->getComponentSignature();
-
-        bool isInterested = (entityComponentSignature & systemComponentSignature) == systemComponentSignature;
+        bool isInterested = system.second->matches(entityComponentSignature);
         if (isInterested) {
             system.second->addEntityToSystem(entity);
         }
     }
 }
 
+void Coordinator::addPrefabInstancesToSystems(const PrefabInstances &instances) {
+    // Instances whose signature was changed before this update are matched
+    // one by one, all others are matched once for the prefab
+    std::vector<Entity> unchangedEntities;
+    unchangedEntities.reserve(instances.entities.getSize());
+    for (auto entity : instances.entities) {
+        const auto entityIndex = entity.getIndex();
+        entityFlags[entityIndex] &= ~ENTITY_PENDING_SYNC;
+        if (entityComponentSignatures[entityIndex] == instances.signature) {
+            entityFlags[entityIndex] |= ENTITY_IN_SYSTEMS;
+            unchangedEntities.push_back(entity);
+        } else {
+            addEntityToSystems(entity);
+        }
+    }
+
+    for (auto &system : systemsInOrder) {
+        if (!system->matches(instances.signature)) {
+            continue;
+        }
+        system->reserve(system->getSystemEntities().getSize() + unchangedEntities.size());
+        for (auto entity : unchangedEntities) {
+            system->addEntityToSystem(entity);
+        }
+    }
+}
+
 void Coordinator::removeEntityFromSystems(Entity entity) {
     for (auto &system : systems) {
         system.second->removeEntityToSystem(entity);
     }
 }
 
-void Coordinator::tagEntity(Entity entity, const std::string &tag) {
-    if (entityPerTag.find(tag) == entityPerTag.end()) {
-        entityPerTag.emplace(tag, entity);
-        tagPerEntityId.emplace(entity.getId(), tag);
+// A thread can run another system while it waits for jobs inside a system, so
+// the tick is saved and restored around every system run
+static thread_local Tick runningSystemLastRunTick = 0;
+
+Tick Coordinator::getRunningSystemLastRunTick() {
+    return runningSystemLastRunTick;
+}
+
+void Coordinator::updateSystems(double deltaTime) {
+    std::vector<System *> enabledSystems;
+    for (auto &system : systemsInOrder) {
+        if (system->isEnabled()) {
+            enabledSystems.push_back(system.get());
+        }
+    }
+    const auto systemCount = enabledSystems.size();
+
+    // Build this frame's dependency graph. A system depends on every system
+    // added before it that it conflicts with, so conflicting systems always
+    // run in the same order.
+    std::vector<std::vector<size_t>> dependents(systemCount);
+    std::vector<std::atomic<size_t>> remainingDependencies(systemCount);
+    std::vector<size_t> independentSystems;
+    for (size_t i = 0; i < systemCount; i++) {
+        size_t dependencies = 0;
+        for (size_t j = 0; j < i; j++) {
+            if (enabledSystems[i]->conflictsWith(*enabledSystems[j])) {
+                dependents[j].push_back(i);
+                dependencies++;
+            }
+        }
+        remainingDependencies[i].store(dependencies);
+        if (dependencies == 0) {
+            independentSystems.push_back(i);
+        }
+    }
+
+    // Run every system as soon as all the systems it depends on finished
+    JobCounter pendingSystems(0);
+    std::function<void(size_t)> runSystem = [&](size_t i) {
+        auto system = enabledSystems[i];
+
+        const auto previousLastRunTick = runningSystemLastRunTick;
+        runningSystemLastRunTick = system->getLastRunTick();
+        system->update(*this, deltaTime);
+        runningSystemLastRunTick = previousLastRunTick;
+
+        // The system's own writes are not newer than the tick at the end of
+        // its run, changes made from now on are. Systems that write what
+        // this system reads conflict with it, so none of them runs meanwhile.
+        system->setLastRunTick(changeTick.fetch_add(1));
+
+        for (auto dependent : dependents[i]) {
+            if (remainingDependencies[dependent].fetch_sub(1) == 1) {
+                threadPool.submit([&runSystem, dependent]() { runSystem(dependent); }, pendingSystems);
+            }
+        }
+    };
+    // NOTE: The independent systems are collected up front, because the
+    // remaining dependencies of other systems reach zero while they run
+    for (auto i : independentSystems) {
+        threadPool.submit([&runSystem, i]() { runSystem(i); }, pendingSystems);
+    }
+    threadPool.wait(pendingSystems);
+}
+
+TagId Coordinator::getTagId(const TagKey &tag) {
+    auto tagId = tagIds.find(tag.hash);
+    if (tagId != tagIds.end()) {
+        assert(tagNames[tagId->second] == tag.name && "Two tag names have the same hash");
+        return tagId->second;
+    }
+    const auto newTagId = static_cast<TagId>(tagNames.size());
+    tagIds.emplace(tag.hash, newTagId);
+    tagNames.emplace_back(tag.name);
+    entityPerTag.emplace_back();
+    return newTagId;
+}
+
+void Coordinator::tagEntity(Entity entity, TagId tag) {
+    // Ignore stale handles, the slot may belong to another entity by now
+    if (!isAlive(entity)) {
+        return;
+    }
+    if (tagPerEntity[entity.getIndex()] == tag) {
+        return;
     }
+    removeEntityTag(entity);
+    removeTag(tag);
+    entityPerTag[tag] = entity;
+    tagPerEntity[entity.getIndex()] = tag;
+}
+
+void Coordinator::tagEntity(Entity entity, const std::string &tag) {
+    tagEntity(entity, getTagId(tag));
+}
 
-    // std::cout << "Current tags after addition" << std::endl;
-    // for (auto entityTag : tagPerEntityId) {
-    //     std::cout << "Entity: " << entityTag.first << ", Tag: " << entityTag.second << std::endl;
-    // }
+bool Coordinator::entityHasTag(Entity entity, TagId tag) const {
+    return entityPerTag[tag] == entity;
 }
 
 bool Coordinator::entityHasTag(Entity entity, const std::string &tag) const {
-    return (
-        entityPerTag.find(tag) != entityPerTag.end()
-        &&
-        entityPerTag.at(tag) == entity
-    );
+    auto tagId = tagIds.find(hashTag(tag));
+    return tagId != tagIds.end() && entityHasTag(entity, tagId->second);
+}
+
+std::optional<Entity> Coordinator::getEntityByTag(TagId tag) const {
+    return entityPerTag[tag];
 }
 
 std::optional<Entity> Coordinator::getEntityByTag(const std::string &tag) const {
-    if (entityPerTag.find(tag) == entityPerTag.end()) {
+    auto tagId = tagIds.find(hashTag(tag));
+    if (tagId == tagIds.end()) {
         return std::nullopt;
     }
-    return entityPerTag.at(tag);
+    return getEntityByTag(tagId->second);
+}
+
+TagId Coordinator::getEntityTag(Entity entity) const {
+    return isAlive(entity) ? tagPerEntity[entity.getIndex()] : NULL_TAG;
 }
 
 void Coordinator::removeEntityTag(Entity entity) {
-    auto entityTag = tagPerEntityId.find(entity.getId());
-    if (entityTag != tagPerEntityId.end()) {
-        tagPerEntityId.erase(entityTag->first);
-        entityPerTag.erase(entityTag->second);
+    // Ignore stale handles, the slot may belong to another entity by now
+    if (!isAlive(entity)) {
+        return;
+    }
+    auto &tag = tagPerEntity[entity.getIndex()];
+    if (tag != NULL_TAG) {
+        entityPerTag[tag].reset();
+        tag = NULL_TAG;
     }
+}
 
-    // std::cout << "Current tags after removal" << std::endl;
-    // for (auto entityTag : tagPerEntityId) {
-    //     std::cout << "Entity: " << entityTag.first << ", Tag: " << entityTag.second << std::endl;
-    // }
+void Coordinator::removeTag(TagId tag) {
+    auto &entity = entityPerTag[tag];
+    if (entity) {
+        tagPerEntity[entity->getIndex()] = NULL_TAG;
+        entity.reset();
+    }
 }
 
 void Coordinator::removeTag(const std::string &tag) {
-    auto tagEntity = entityPerTag.find(tag);
-    if (tagEntity != entityPerTag.end()) {
-        entityPerTag.erase(tagEntity->first);
-        tagPerEntityId.erase(tagEntity->second.getId());
+    auto tagId = tagIds.find(hashTag(tag));
+    if (tagId != tagIds.end()) {
+        removeTag(tagId->second);
     }
 }
 
-void Coordinator::groupEntity(Entity entity, const std::string &group) {
-    if (entitiesPerGroup.find(group) == entitiesPerGroup.end()) {
-        entitiesPerGroup.emplace(group, std::set<Entity>());
+GroupId Coordinator::getGroupId(const std::string &group) {
+    auto groupId = groupIds.find(group);
+    if (groupId != groupIds.end()) {
+        return groupId->second;
     }
-    if (groupsPerEntityId.find(entity.getId()) == groupsPerEntityId.end()) {
-        groupsPerEntityId.emplace(entity.getId(), std::set<std::string>());
+    // Group ids index fixed size arrays, so there is no id to hand out
+    if (groupIds.size() >= MAX_GROUPS) {
+        throw std::length_error("Too many groups, increase PIXEL_MAX_GROUPS");
     }
-
-    entitiesPerGroup.at(group).insert(entity);
-    groupsPerEntityId.at(entity.getId()).insert(group);
+    const auto newGroupId = static_cast<GroupId>(groupIds.size());
+    groupIds.emplace(group, newGroupId);
+    return newGroupId;
 }
 
-bool Coordinator::entityBelongsToGroup(Entity entity, const std::string &group) {
-    if (entitiesPerGroup.find(group) == entitiesPerGroup.end()) {
-        return false;
+void Coordinator::groupEntity(Entity entity, GroupId group) {
+    // Ignore stale handles, the slot may belong to another entity by now
+    if (!isAlive(entity)) {
+        return;
+    }
+    auto &entityGroups = groupsPerEntity[entity.getIndex()];
+    if (!entityGroups.test(group)) {
+        entityGroups.set(group);
+        entitiesPerGroup[group].insert(entity);
     }
-    auto groupEntities = entitiesPerGroup.at(group);
-    return groupEntities.find(entity) != groupEntities.end();
 }
 
-std::vector<Entity> Coordinator::getEntitiesByGroup(const std::string &group) {
-    if (entitiesPerGroup.find(group) == entitiesPerGroup.end()) {
-        return std::vector<Entity>();
+void Coordinator::groupEntity(Entity entity, const std::string &group) {
+    groupEntity(entity, getGroupId(group));
+}
+
+bool Coordinator::entityBelongsToGroup(Entity entity, GroupId group) const {
+    return isAlive(entity) && groupsPerEntity[entity.getIndex()].test(group);
+}
+
+bool Coordinator::entityBelongsToGroup(Entity entity, const std::string &group) const {
+    auto groupId = groupIds.find(group);
+    return groupId != groupIds.end() && entityBelongsToGroup(entity, groupId->second);
+}
+
+const SparseSet &Coordinator::getEntitiesByGroup(GroupId group) const {
+    return entitiesPerGroup[group];
+}
+
+const SparseSet &Coordinator::getEntitiesByGroup(const std::string &group) {
+    return entitiesPerGroup[getGroupId(group)];
+}
+
+void Coordinator::removeEntityGroup(Entity entity, GroupId group) {
+    // Ignore stale handles, the slot may belong to another entity by now
+    if (!isAlive(entity)) {
+        return;
+    }
+    auto &entityGroups = groupsPerEntity[entity.getIndex()];
+    if (entityGroups.test(group)) {
+        entityGroups.reset(group);
+        entitiesPerGroup[group].remove(entity);
     }
-    // TODO: FIXME: Does this need to return a reference?
-    auto groupEntities = entitiesPerGroup.at(group);
-    return std::vector<Entity>(groupEntities.begin(), groupEntities.end());
 }
 
 void Coordinator::removeEntityGroup(Entity entity, const std::string &group) {
-    // Check if entity is registered in any group
-    if (groupsPerEntityId.find(entity.getId()) != groupsPerEntityId.end()) {
-        // Get all the groups the entity is in
-        auto &entityGroups = groupsPerEntityId.at(entity.getId());
-        // Get all the entities the group contains
-        auto &groupEntities = entitiesPerGroup.at(group);
-        // Check if the entity is registered in the provided group
-        if (entityGroups.find(group) != entityGroups.end()) {
-            // Unregister the entity from the group
-            entityGroups.erase(group);
-            groupEntities.erase(entity);
-
-            // Remove the entity from the group system if no groups are applied
-            if (entityGroups.empty()) {
-                groupsPerEntityId.erase(entity.getId());
-            }
-            // Remove the group from the group system if no entites are contained
-            if (groupEntities.empty()) {
-                entitiesPerGroup.erase(group);
-            }
-        }
+    auto groupId = groupIds.find(group);
+    if (groupId != groupIds.end()) {
+        removeEntityGroup(entity, groupId->second);
     }
 }
 
 void Coordinator::removeEntityGroups(Entity entity) {
-    if (groupsPerEntityId.find(entity.getId()) != groupsPerEntityId.end()) {
-        auto entityGroups = groupsPerEntityId.at(entity.getId());
-        for (auto group : entityGroups) {
-            entitiesPerGroup.at(group).erase(entity);
-            if (entitiesPerGroup.at(group).empty()) {
-                entitiesPerGroup.erase(group);
-            }
-        }
-        groupsPerEntityId.erase(entity.getId());
+    // Ignore stale handles, the slot may belong to another entity by now
+    if (!isAlive(entity)) {
+        return;
+    }
+    auto &entityGroups = groupsPerEntity[entity.getIndex()];
+    entityGroups.forEach([&](GroupId group) {
+        entitiesPerGroup[group].remove(entity);
+    });
+    entityGroups.reset();
+}
+
+void Coordinator::removeGroup(GroupId group) {
+    // NOTE: The group keeps its id, so handles to it stay valid
+    for (auto entity : entitiesPerGroup[group]) {
+        groupsPerEntity[entity.getIndex()].reset(group);
     }
+    entitiesPerGroup[group].clear();
 }
 
 void Coordinator::removeGroup(const std::string &group) {
-    if (entitiesPerGroup.find(group) != entitiesPerGroup.end()) {
-        auto groupEntities = entitiesPerGroup.at(group);
-        for (auto entity : groupEntities) {
-            groupsPerEntityId.at(entity.getId()).erase(group);
-            if (groupsPerEntityId.at(entity.getId()).empty()) {
-                groupsPerEntityId.erase(entity.getId());
-            }
-        }
-        entitiesPerGroup.erase(group);
+    auto groupId = groupIds.find(group);
+    if (groupId != groupIds.end()) {
+        removeGroup(groupId->second);
     }
 }
 
 void Coordinator::update() {
+    playbackCommandBuffers();
+
     for (auto entity : entitiesToBeCreated) {
+        entityFlags[entity.getIndex()] &= ~ENTITY_PENDING_SYNC;
         addEntityToSystems(entity);
     }
     entitiesToBeCreated.clear();
 
+    for (const auto &instances : prefabInstancesToBeCreated) {
+        addPrefabInstancesToSystems(instances);
+    }
+    prefabInstancesToBeCreated.clear();
+
+    syncSignatureChanges();
+
+    destroyEntities();
+
+    if (compactBudget > 0 && getUnusedBytes() > compactBudget) {
+        compact();
+    }
+}
+
+size_t Coordinator::getUnusedBytes() const {
+    if (storageBackend == StorageBackend::Archetypes) {
+        return archetypes.getUnusedBytes();
+    }
+
+    size_t unusedBytes = 0;
+    for (const auto &pool : componentPools) {
+        if (pool) {
+            unusedBytes += pool->getUnusedBytes();
+        }
+    }
+    return unusedBytes;
+}
+
+size_t Coordinator::shrinkEntitySlots() {
+    // Trailing slots can be released if their indices are free, or were
+    // never handed out
+    const auto slotCount = entityComponentSignatures.size();
+    std::vector<bool> isFree(slotCount, false);
+    for (auto entityIndex : freeIds) {
+        if (entityIndex < slotCount) {
+            isFree[entityIndex] = true;
+        }
+    }
+    size_t usedSlotCount = std::min<size_t>(numEntites, slotCount);
+    while (usedSlotCount > 0 && isFree[usedSlotCount - 1]) {
+        usedSlotCount--;
+    }
+
+    // NOTE: The generations are kept, so that the released indices come back
+    // with their next generation and stale handles to them stay stale.
+    if (usedSlotCount < slotCount) {
+        entityComponentSignatures.resize(usedSlotCount);
+        entityFlags.resize(usedSlotCount);
+        groupsPerEntity.resize(usedSlotCount);
+        tagPerEntity.resize(usedSlotCount);
+    }
+    return (
+        releaseUnusedCapacity(entityComponentSignatures)
+        + releaseUnusedCapacity(entityFlags)
+        + releaseUnusedCapacity(groupsPerEntity)
+        + releaseUnusedCapacity(tagPerEntity)
+    );
+}
+
+size_t Coordinator::compact() {
+    size_t releasedBytes = shrinkEntitySlots();
+
+    if (storageBackend == StorageBackend::Archetypes) {
+        releasedBytes += archetypes.shrinkToFit(entityComponentSignatures.size());
+    } else {
+        for (auto &pool : componentPools) {
+            if (pool) {
+                releasedBytes += pool->shrinkToFit();
+            }
+        }
+    }
+
+    for (auto &system : systemsInOrder) {
+        releasedBytes += system->shrinkToFit();
+    }
+    for (auto &group : entitiesPerGroup) {
+        releasedBytes += group.shrinkToFit();
+    }
+
+    // The buffers that only hold entities until the next update
+    for (auto &entities : entitiesToRemovePerPool) {
+        releasedBytes += releaseUnusedCapacity(entities);
+    }
+    releasedBytes += releaseUnusedCapacity(entitiesToBeDestroyed);
+    releasedBytes += releaseUnusedCapacity(signatureChanges);
+
+    spdlog::debug("Compacted the coordinator, released {} bytes", releasedBytes);
+
+    return releasedBytes;
+}
+
+void Coordinator::destroyEntities() {
+    std::sort(entitiesToBeDestroyed.begin(), entitiesToBeDestroyed.end());
+    entitiesToBeDestroyed.erase(
+        std::unique(entitiesToBeDestroyed.begin(), entitiesToBeDestroyed.end()),
+        entitiesToBeDestroyed.end()
+    );
+
+    // The pools that have entities to remove
+    ComponentSignature poolsToCompact;
+
     for (auto entity : entitiesToBeDestroyed) {
+        // Ignore stale handles and entities that were destroyed twice
+        if (!isAlive(entity)) {
+            continue;
+        }
+
+        const auto entityIndex = entity.getIndex();
+        auto &signature = entityComponentSignatures[entityIndex];
+
         // Remove the entity from all systems
         removeEntityFromSystems(entity);
 
-        // Reset the component signature for the destroyed entity
-        entityComponentSignatures[entity.getId()].reset();
+        // Remove the entity from the component storage, only touching the
+        // pools of the components in its signature once it left its groups
+        if (storageBackend == StorageBackend::Archetypes) {
+            archetypes.destroy(entity);
+        } else {
+            removeFromOwningGroups(entity, signature);
+            // Tags have no pool
+            signature.forEach([&](ComponentId componentId) {
+                if (componentPools[componentId]) {
+                    entitiesToRemovePerPool[componentId].push_back(entity);
+                    poolsToCompact.set(componentId);
+                }
+            });
+        }
 
-        // Remove the entity from the component pools
-        for (auto pool : componentPools) {
-            if (pool) {
-                pool->remove(entity.getId());
-            }
+        if (signature.intersects(DISABLED_SIGNATURE)) {
+            disabledEntityCount--;
         }
 
-        // Make the entity id available to be reused
-        freeIds.push_back(entity.getId());
+        // Reset the component signature for the destroyed entity
+        signature.reset();
 
         // Remove all traces of entity in tags and groups
-        removeEntityTag(entity);
-        removeEntityGroups(entity);
+        if (tagPerEntity[entityIndex] != NULL_TAG) {
+            removeEntityTag(entity);
+        }
+        if (groupsPerEntity[entityIndex].any()) {
+            removeEntityGroups(entity);
+        }
+        entityFlags[entityIndex] = 0;
+
+        // Make the entity index available to be reused, invalidating all
+        // handles to the destroyed entity
+        // NOTE: No system runs during update, so no command buffer reserves
+        // from the free indices here.
+        freeIds.push_back(entityIndex);
+        entityGenerations[entityIndex] = (entityGenerations[entityIndex] + 1) & ENTITY_GENERATION_MASK;
     }
     entitiesToBeDestroyed.clear();
-}
\ No newline at end of file
+
+    poolsToCompact.forEach([&](ComponentId componentId) {
+        componentPools[componentId]->removeBatch(entitiesToRemovePerPool[componentId]);
+        entitiesToRemovePerPool[componentId].clear();
+    });
+}
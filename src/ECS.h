@@ -1,31 +1,66 @@
 #ifndef ECS_H
 #define ECS_H
 
+#include "Signature.h"
+#include "ThreadPool.h"
+#include "VirtualMemory.h"
+
 #include <spdlog/spdlog.h>
 
-#include <bitset>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <vector>
 #include <unordered_map>
 #include <deque>
 #include <typeindex>
+#include <tuple>
+#include <type_traits>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <iterator>
 
 ////////////////////////////////////////////////////////////////////////////////
 // Component Signature
 ////////////////////////////////////////////////////////////////////////////////
 // We will use a bitset to keep track of which components an entity has.
 // This will also help keep track of which entities a system is interested in.
+// The number of component types can be configured at compile time with
+// -DPIXEL_MAX_COMPONENTS=<64, 128, 256, ..., 1024>.
 ////////////////////////////////////////////////////////////////////////////////
-const size_t MAX_COMPONENTS = 32;
-using ComponentSignature = std::bitset<MAX_COMPONENTS>;
+#ifndef PIXEL_MAX_COMPONENTS
+#define PIXEL_MAX_COMPONENTS 128
+#endif
+
+const size_t MAX_COMPONENTS = PIXEL_MAX_COMPONENTS;
+using ComponentSignature = Signature<MAX_COMPONENTS>;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Entity
 ////////////////////////////////////////////////////////////////////////////////
 // An Entity is just an ID that represents a game object.
+// The 32-bit ID packs the index of the entity's slot together with the
+// generation of that slot, which is bumped every time the slot is freed. A
+// handle kept around after its entity was destroyed can therefore never be
+// mistaken for the entity that reuses the slot.
+// [ Bits 0-19 = index, Bits 20-31 = generation ]
 ////////////////////////////////////////////////////////////////////////////////
-using EntityId = size_t;
+using EntityId = uint32_t;
+
+const EntityId ENTITY_INDEX_BITS = 20;
+const EntityId ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+const EntityId ENTITY_GENERATION_BITS = 12;
+const EntityId ENTITY_GENERATION_MASK = (1u << ENTITY_GENERATION_BITS) - 1;
+const size_t MAX_ENTITIES = size_t(1) << ENTITY_INDEX_BITS;
 
 class Entity {
     private:
@@ -37,9 +72,14 @@ class Entity {
         ////////////////////////////////////////////////////////////////////////
         Entity() = default;
         Entity(EntityId id) { this->id = id; }
+        Entity(EntityId index, EntityId generation) {
+            this->id = ((generation & ENTITY_GENERATION_MASK) << ENTITY_INDEX_BITS) | (index & ENTITY_INDEX_MASK);
+        }
         Entity(const Entity &entity) = default;
 
         EntityId getId() const { return id; }
+        EntityId getIndex() const { return id & ENTITY_INDEX_MASK; }
+        EntityId getGeneration() const { return id >> ENTITY_INDEX_BITS; }
 
         ////////////////////////////////////////////////////////////////////////
         // Operator overloading
@@ -55,6 +95,24 @@ class Entity {
         bool operator >=(const Entity &other) const { return id >= other.id; }
 };
 
+// The entities that were created together by Coordinator::create(n) or
+// Coordinator::instantiate. Free indices are reused first, like create()
+// does, so the indices are not necessarily contiguous.
+class EntityRange {
+    private:
+        std::vector<Entity> entities;
+
+    public:
+        EntityRange() = default;
+        explicit EntityRange(std::vector<Entity> entities) : entities(std::move(entities)) {}
+
+        size_t getSize() const { return entities.size(); }
+        Entity operator [](size_t i) const { return entities[i]; }
+
+        std::vector<Entity>::const_iterator begin() const { return entities.begin(); }
+        std::vector<Entity>::const_iterator end() const { return entities.end(); }
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // Entity Manager
 ////////////////////////////////////////////////////////////////////////////////
@@ -78,149 +136,1406 @@ class Entity {
 //         void destroy(Entity entity);
 // };
 
+////////////////////////////////////////////////////////////////////////////////
+// Entity Group
+////////////////////////////////////////////////////////////////////////////////
+// Group names are interned to small ids by the coordinator, so membership is
+// a single bit in the group signature of an entity.
+// The number of groups can be configured at compile time with
+// -DPIXEL_MAX_GROUPS=<64, 128, 256, ..., 1024>.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef PIXEL_MAX_GROUPS
+#define PIXEL_MAX_GROUPS 64
+#endif
+
+using GroupId = uint16_t;
+
+const size_t MAX_GROUPS = PIXEL_MAX_GROUPS;
+using GroupSignature = Signature<MAX_GROUPS>;
+
+////////////////////////////////////////////////////////////////////////////////
+// Entity Tag
+////////////////////////////////////////////////////////////////////////////////
+// Tag names are interned to compact ids by the coordinator, keyed by the
+// FNV-1a hash of the name. A TagKey hashes its name when it is constructed,
+// which happens at compile time for a constexpr TagKey:
+//     static constexpr TagKey PLAYER_TAG = "player";
+// [ Tag id = index of the tag in the order it was interned ]
+////////////////////////////////////////////////////////////////////////////////
+using TagId = uint32_t;
+
+const TagId NULL_TAG = std::numeric_limits<TagId>::max();
+
+constexpr uint64_t hashTag(std::string_view tag) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : tag) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+struct TagKey {
+    uint64_t hash;
+    std::string_view name;
+
+    constexpr TagKey(std::string_view name) : hash(hashTag(name)), name(name) {}
+    constexpr TagKey(const char *name) : TagKey(std::string_view(name)) {}
+    TagKey(const std::string &name) : TagKey(std::string_view(name)) {}
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // Component
 ////////////////////////////////////////////////////////////////////////////////
 // A Component is pure data.
+// Every component type is registered next to its definition with a fixed id:
+//     REGISTER_COMPONENT(TransformComponent, 0);
+// The ids are compile-time constants that do not depend on the order the
+// components are first used in, so they are the same in every run and can be
+// referred to by snapshots and replays. Ids must be unique and smaller than
+// MAX_COMPONENTS - 1, the last id is reserved for the Disabled tag.
+// Registering two types with the same id fails to compile with a
+// redefinition of ComponentIdRegistry<id> in every translation unit that
+// sees both registrations, so components are best registered in headers.
 ////////////////////////////////////////////////////////////////////////////////
 using ComponentId = size_t;
 
-struct IComponent {
-    protected:
-        static ComponentId nextId;
-};
+// The last component id is reserved for the Disabled tag
+const ComponentId DISABLED_COMPONENT_ID = MAX_COMPONENTS - 1;
+
+template <typename T>
+struct ComponentRegistry {
+    static constexpr bool registered = false;
+};
+
+// The type registered with every id, only defined for registered ids
+template <ComponentId componentId>
+struct ComponentIdRegistry;
+
+#define REGISTER_COMPONENT(TComponent, componentId) \
+    template <> \
+    struct ComponentIdRegistry<(componentId)> { \
+        using Type = TComponent; \
+    }; \
+    template <> \
+    struct ComponentRegistry<TComponent> { \
+        static_assert((componentId) < DISABLED_COMPONENT_ID, "Component id is out of range, the last id is reserved"); \
+        static constexpr bool registered = true; \
+        static constexpr ComponentId id = (componentId); \
+        static constexpr const char *name = #TComponent; \
+    }
+
+template <typename T>
+struct Component {
+    static_assert(ComponentRegistry<T>::registered, "Component type is not registered, see REGISTER_COMPONENT");
+
+    static constexpr ComponentId getId() {
+        return ComponentRegistry<T>::id;
+    }
+
+    static constexpr const char *getName() {
+        return ComponentRegistry<T>::name;
+    }
+};
+
+// Empty component types are tags. They have no storage at all and are only
+// recorded as a bit in the component signature of an entity.
+template <typename T>
+constexpr bool isTagComponent = std::is_empty_v<T>;
+
+// Tags have no storage, so every entity shares the same instance of a tag.
+template <typename T>
+T &getTagInstance() {
+    static_assert(isTagComponent<T>, "Only tags share an instance");
+    static T instance;
+    return instance;
+}
+
+// The signature with the bits of all given component types set
+template <typename ...TComponents>
+constexpr ComponentSignature getComponentSignature() {
+    ComponentSignature signature;
+    (signature.set(Component<TComponents>::getId()), ...);
+    return signature;
+}
+
+// The tag of entities disabled with Coordinator::disable. It is registered
+// by hand, because REGISTER_COMPONENT does not accept its reserved id.
+struct Disabled {};
+
+template <>
+struct ComponentIdRegistry<DISABLED_COMPONENT_ID> {
+    using Type = Disabled;
+};
+
+template <>
+struct ComponentRegistry<Disabled> {
+    static constexpr bool registered = true;
+    static constexpr ComponentId id = DISABLED_COMPONENT_ID;
+    static constexpr const char *name = "Disabled";
+};
+
+const ComponentSignature DISABLED_SIGNATURE = getComponentSignature<Disabled>();
+
+// Marks a component type of a view that entities may or may not have. The
+// view hands out a pointer to it, which is nullptr if the entity lacks it.
+//     coordinator.view<TransformComponent, Optional<RigidBodyComponent>>()
+template <typename TComponent>
+struct Optional {};
+
+// The component types that entities of a view must not have.
+//     coordinator.view<TransformComponent>(Exclude<RigidBodyComponent>())
+template <typename ...TComponents>
+struct Exclude {};
+
+// How a component type of a view is stored and handed out.
+template <typename T>
+struct ViewComponent {
+    using Type = T;
+    using Argument = T &;
+    static constexpr bool isOptional = false;
+    static constexpr bool isTag = isTagComponent<T>;
+};
+
+template <typename T>
+struct ViewComponent<Optional<T>> {
+    using Type = T;
+    using Argument = T *;
+    static constexpr bool isOptional = true;
+    static constexpr bool isTag = isTagComponent<T>;
+};
+
+// The signature with the bits of all given component types set, except for
+// the optional ones
+template <typename ...TComponents>
+constexpr ComponentSignature getRequiredSignature() {
+    ComponentSignature signature;
+    ((ViewComponent<TComponents>::isOptional ? void() : void(signature.set(Component<typename ViewComponent<TComponents>::Type>::getId()))), ...);
+    return signature;
+}
+
+// The signature with the bits of all given tags set, except for the optional
+// ones
+template <typename ...TComponents>
+constexpr ComponentSignature getRequiredTagSignature() {
+    ComponentSignature signature;
+    ((ViewComponent<TComponents>::isOptional || !ViewComponent<TComponents>::isTag ? void() : void(signature.set(Component<typename ViewComponent<TComponents>::Type>::getId()))), ...);
+    return signature;
+}
+
+// Compacting keeps room for as many objects again as an array holds, the
+// room it would have after its next growth anyway. Otherwise an array that
+// is still growing would be shrunk and copied again every time.
+const size_t GROWTH_SLACK = 2;
+
+// The bytes allocated past the growth slack of the array, which
+// releaseUnusedCapacity gives back
+template <typename T>
+size_t getUnusedBytes(const std::vector<T> &array) {
+    const auto keptCapacity = GROWTH_SLACK * array.size();
+    return array.capacity() > keptCapacity ? (array.capacity() - keptCapacity) * sizeof(T) : 0;
+}
+
+template <typename T, size_t MaxSize>
+size_t getUnusedBytes(const VirtualVector<T, MaxSize> &array) {
+    return array.getCommittedBytesPast(GROWTH_SLACK * array.size());
+}
+
+// Gives the capacity of the array past its growth slack back and returns the
+// bytes released
+template <typename T>
+size_t releaseUnusedCapacity(std::vector<T> &array) {
+    const auto releasedBytes = getUnusedBytes(array);
+    if (releasedBytes > 0) {
+        std::vector<T> shrunkArray;
+        shrunkArray.reserve(GROWTH_SLACK * array.size());
+        std::move(array.begin(), array.end(), std::back_inserter(shrunkArray));
+        array.swap(shrunkArray);
+    }
+    return releasedBytes;
+}
+
+template <typename T, size_t MaxSize>
+size_t releaseUnusedCapacity(VirtualVector<T, MaxSize> &array) {
+    return array.decommitPast(std::min(GROWTH_SLACK * array.size(), MaxSize));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sparse Set
+////////////////////////////////////////////////////////////////////////////////
+// A Sparse Set maps entities to indices of a packed (dense) array of entities.
+// The sparse array is split into fixed size pages that are only allocated
+// when an entity index inside of them is inserted.
+// [ Sparse index = entity index ]
+// [ Dense index = position of the entity in the packed array ]
+////////////////////////////////////////////////////////////////////////////////
+class SparseSet {
+    public:
+        static constexpr size_t PAGE_SIZE = 4096;
+        static constexpr uint32_t NULL_INDEX = std::numeric_limits<uint32_t>::max();
+
+    private:
+        std::vector<std::unique_ptr<uint32_t[]>> sparse;
+        std::vector<Entity> dense;
+
+        uint32_t *getPage(EntityId index) const {
+            const auto page = index / PAGE_SIZE;
+            return page < sparse.size() ? sparse[page].get() : nullptr;
+        }
+
+        uint32_t &assurePage(EntityId index) {
+            const auto page = index / PAGE_SIZE;
+            if (page >= sparse.size()) {
+                sparse.resize(page + 1);
+            }
+            if (!sparse[page]) {
+                sparse[page] = std::make_unique<uint32_t[]>(PAGE_SIZE);
+                std::fill_n(sparse[page].get(), PAGE_SIZE, NULL_INDEX);
+            }
+            return sparse[page][index % PAGE_SIZE];
+        }
+
+        uint32_t &getSparse(EntityId index) const {
+            return sparse[index / PAGE_SIZE][index % PAGE_SIZE];
+        }
+
+    public:
+        SparseSet() = default;
+        ~SparseSet() = default;
+
+        bool isEmpty() const {
+            return dense.empty();
+        }
+
+        size_t getSize() const {
+            return dense.size();
+        }
+
+        void reserve(size_t n) {
+            dense.reserve(n);
+        }
+
+        void clear() {
+            sparse.clear();
+            dense.clear();
+        }
+
+        size_t getUnusedBytes() const {
+            return ::getUnusedBytes(dense);
+        }
+
+        // Frees the pages that no longer hold an entity and the unused
+        // capacity of the dense array. Returns the number of bytes freed.
+        size_t shrinkToFit() {
+            std::vector<bool> isPageUsed(sparse.size(), false);
+            for (auto entity : dense) {
+                isPageUsed[entity.getIndex() / PAGE_SIZE] = true;
+            }
+
+            size_t freedBytes = 0;
+            for (size_t page = 0; page < sparse.size(); page++) {
+                if (sparse[page] && !isPageUsed[page]) {
+                    sparse[page].reset();
+                    freedBytes += PAGE_SIZE * sizeof(uint32_t);
+                }
+            }
+            while (!sparse.empty() && !sparse.back()) {
+                sparse.pop_back();
+            }
+            return freedBytes + releaseUnusedCapacity(sparse) + releaseUnusedCapacity(dense);
+        }
+
+        // NOTE: A stale handle to a reused slot is not contained in the set.
+        bool contains(Entity entity) const {
+            const auto page = getPage(entity.getIndex());
+            if (!page) {
+                return false;
+            }
+            const auto index = page[entity.getIndex() % PAGE_SIZE];
+            return index != NULL_INDEX && dense[index] == entity;
+        }
+
+        // Checks if any generation of the entity index is contained in the set
+        bool containsIndex(EntityId entityIndex) const {
+            const auto page = getPage(entityIndex);
+            return page && page[entityIndex % PAGE_SIZE] != NULL_INDEX;
+        }
+
+        // NOTE: The entity must be contained in the set.
+        size_t indexOf(Entity entity) const {
+            return getSparse(entity.getIndex());
+        }
+
+        // Appends the entity to the end of the dense array and returns its index.
+        // NOTE: The entity must not already be contained in the set.
+        size_t insert(Entity entity) {
+            const auto index = dense.size();
+            assurePage(entity.getIndex()) = static_cast<uint32_t>(index);
+            dense.push_back(entity);
+            return index;
+        }
+
+        // Removes all given entities in one pass over the dense array that
+        // keeps the order of the remaining entities, calling move(from, to) for
+        // every entity that is moved down. Returns the new size of the set.
+        // NOTE: Entities that are not contained in the set are ignored.
+        template <typename TMove>
+        size_t removeBatch(const std::vector<Entity> &entitiesToRemove, TMove move) {
+            for (auto entity : entitiesToRemove) {
+                if (contains(entity)) {
+                    getSparse(entity.getIndex()) = NULL_INDEX;
+                }
+            }
+
+            size_t size = 0;
+            for (size_t index = 0; index < dense.size(); index++) {
+                const auto entity = dense[index];
+                if (getSparse(entity.getIndex()) == NULL_INDEX) {
+                    continue;
+                }
+                if (index != size) {
+                    dense[size] = entity;
+                    getSparse(entity.getIndex()) = static_cast<uint32_t>(size);
+                    move(index, size);
+                }
+                size++;
+            }
+            dense.erase(dense.begin() + size, dense.end());
+            return size;
+        }
+
+        // Moves the last entity into the slot of the removed entity and returns
+        // the index that was freed up.
+        // NOTE: The entity must be contained in the set.
+        size_t remove(Entity entity) {
+            const auto index = indexOf(entity);
+            const auto last = dense.back();
+            dense[index] = last;
+            getSparse(last.getIndex()) = static_cast<uint32_t>(index);
+            getSparse(entity.getIndex()) = NULL_INDEX;
+            dense.pop_back();
+            return index;
+        }
+
+        // Swaps the entities at the two indices of the dense array.
+        void swap(size_t a, size_t b) {
+            std::swap(dense[a], dense[b]);
+            getSparse(dense[a].getIndex()) = static_cast<uint32_t>(a);
+            getSparse(dense[b].getIndex()) = static_cast<uint32_t>(b);
+        }
+
+        const Entity *data() const {
+            return dense.data();
+        }
+
+        Entity operator [](size_t index) const {
+            return dense[index];
+        }
+
+        std::vector<Entity>::const_iterator begin() const { return dense.begin(); }
+        std::vector<Entity>::const_iterator end() const { return dense.end(); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Pool
+////////////////////////////////////////////////////////////////////////////////
+// A Pool is a sparse set of entities together with a vector of objects of
+// type T, where the object at index i belongs to the entity at dense index i.
+// Objects are constructed in place when they are added and only need to be
+// movable, not copyable or default constructible.
+// For change tracking every object also stores the tick it was added at and
+// the tick it was last changed at.
+// Pools of components registered with RESERVE_COMPONENT_POOL keep their
+// objects and ticks in virtual vectors instead, which reserve room for
+// MAX_ENTITIES objects. They grow without copying, and components keep their
+// address until their entity leaves the pool or is swapped by an owning group.
+////////////////////////////////////////////////////////////////////////////////
+using Tick = uint32_t;
+
+// Checks if a tick is newer than another, allowing the ticks to wrap around.
+inline bool isNewerTick(Tick tick, Tick other) {
+    return static_cast<int32_t>(tick - other) > 0;
+}
+
+template <typename T>
+struct PoolStorage {
+    template <typename U> using Array = std::vector<U>;
+};
+
+#define RESERVE_COMPONENT_POOL(TComponent) \
+    template <> \
+    struct PoolStorage<TComponent> { \
+        template <typename U> using Array = VirtualVector<U, MAX_ENTITIES>; \
+    }
+
+class IPool {
+    public:
+        virtual ~IPool() = default;
+        virtual void remove(Entity entity) = 0;
+        virtual void removeBatch(const std::vector<Entity> &entities) = 0;
+        virtual void swap(size_t a, size_t b) = 0;
+        virtual const SparseSet &getEntities() const = 0;
+        virtual size_t getUnusedBytes() const = 0;
+        virtual size_t shrinkToFit() = 0;
+};
+
+template <typename T>
+class Pool : public IPool {
+    private:
+        template <typename U> using Array = typename PoolStorage<T>::template Array<U>;
+
+        SparseSet entities;
+        Array<T> data;
+        Array<Tick> addedTicks;
+        Array<Tick> changedTicks;
+
+    public:
+        Pool(int capacity = 100) {
+            reserve(capacity);
+        }
+
+        virtual ~Pool() = default;
+
+        bool isEmpty() const {
+            return entities.isEmpty();
+        }
+
+        int getSize() const {
+            return static_cast<int>(entities.getSize());
+        }
+
+        void reserve(int n) {
+            entities.reserve(n);
+            data.reserve(n);
+            addedTicks.reserve(n);
+            changedTicks.reserve(n);
+        }
+
+        // NOTE: Keeps the capacity of the pool, see shrinkToFit.
+        void clear() {
+            entities.clear();
+            data.clear();
+            addedTicks.clear();
+            changedTicks.clear();
+        }
+
+        size_t getUnusedBytes() const override {
+            return entities.getUnusedBytes() + ::getUnusedBytes(data) + ::getUnusedBytes(addedTicks) + ::getUnusedBytes(changedTicks);
+        }
+
+        // Gives the capacity past the last object and the empty sparse pages
+        // back. Returns the number of bytes released.
+        size_t shrinkToFit() override {
+            return (
+                entities.shrinkToFit()
+                + releaseUnusedCapacity(data)
+                + releaseUnusedCapacity(addedTicks)
+                + releaseUnusedCapacity(changedTicks)
+            );
+        }
+
+        bool contains(Entity entity) const {
+            return entities.contains(entity);
+        }
+
+        // Appends a copy of the object for every entity of the range.
+        // NOTE: The entities must not already be contained in the pool.
+        template <typename TEntities>
+        void insertCopies(const TEntities &entitiesToAdd, const T &object, Tick tick) {
+            const auto count = entitiesToAdd.getSize();
+            data.insert(data.end(), count, object);
+            addedTicks.insert(addedTicks.end(), count, tick);
+            changedTicks.insert(changedTicks.end(), count, tick);
+            entities.reserve(entities.getSize() + count);
+            for (auto entity : entitiesToAdd) {
+                entities.insert(entity);
+            }
+        }
+
+        // Constructs the object of the entity from the arguments, directly in
+        // the pool's storage, and returns it. Throws std::invalid_argument if
+        // the index of the entity is used by another generation in the pool.
+        template <typename ...TArgs>
+        T &emplace(Entity entity, Tick tick, TArgs &&...args) {
+            if (entities.contains(entity)) {
+                // If the element already exists, simply replace the object
+                const auto index = entities.indexOf(entity);
+                data[index] = T(std::forward<TArgs>(args)...);
+                changedTicks[index] = tick;
+                return data[index];
+            }
+            if (entities.containsIndex(entity.getIndex())) {
+                throw std::invalid_argument("Entity index is used by another generation of the entity");
+            }
+            auto &object = data.emplace_back(std::forward<TArgs>(args)...);
+            entities.insert(entity);
+            addedTicks.push_back(tick);
+            changedTicks.push_back(tick);
+            return object;
+        }
+
+        void set(Entity entity, T object, Tick tick = 0) {
+            emplace(entity, tick, std::move(object));
+        }
+
+        void remove(Entity entity) override {
+            if (!entities.contains(entity)) {
+                return;
+            }
+
+            // Mirror the swap-and-pop of the sparse set in the data vectors
+            const auto index = entities.remove(entity);
+            if (index != data.size() - 1) {
+                data[index] = std::move(data.back());
+                addedTicks[index] = addedTicks.back();
+                changedTicks[index] = changedTicks.back();
+            }
+            data.pop_back();
+            addedTicks.pop_back();
+            changedTicks.pop_back();
+        }
+
+        void removeBatch(const std::vector<Entity> &entitiesToRemove) override {
+            // Removing a few entities is cheaper with swap-and-pop, removing
+            // many is cheaper with a single compaction pass
+            if (entitiesToRemove.size() * 4 < entities.getSize()) {
+                for (auto entity : entitiesToRemove) {
+                    remove(entity);
+                }
+                return;
+            }
+
+            const auto size = entities.removeBatch(entitiesToRemove, [this](size_t from, size_t to) {
+                data[to] = std::move(data[from]);
+                addedTicks[to] = addedTicks[from];
+                changedTicks[to] = changedTicks[from];
+            });
+            data.erase(data.begin() + size, data.end());
+            addedTicks.resize(size);
+            changedTicks.resize(size);
+        }
+
+        // Swaps the entities and objects at the two indices of the pool.
+        void swap(size_t a, size_t b) override {
+            if (a != b) {
+                entities.swap(a, b);
+                std::swap(data[a], data[b]);
+                std::swap(addedTicks[a], addedTicks[b]);
+                std::swap(changedTicks[a], changedTicks[b]);
+            }
+        }
+
+        // NOTE: The entity must have an object in the pool.
+        T &get(Entity entity) {
+            return data[entities.indexOf(entity)];
+        }
+
+        const T &get(Entity entity) const {
+            return data[entities.indexOf(entity)];
+        }
+
+        // NOTE: The entity must have an object in the pool.
+        void markChanged(Entity entity, Tick tick) {
+            changedTicks[entities.indexOf(entity)] = tick;
+        }
+
+        // NOTE: The entity must have an object in the pool.
+        Tick getAddedTick(Entity entity) const {
+            return addedTicks[entities.indexOf(entity)];
+        }
+
+        // NOTE: The entity must have an object in the pool.
+        Tick getChangedTick(Entity entity) const {
+            return changedTicks[entities.indexOf(entity)];
+        }
+
+        const SparseSet &getEntities() const override {
+            return entities;
+        }
+
+        T *getData() {
+            return data.data();
+        }
+
+        T &operator [](int index) {
+            return data[index];
+        }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Archetype
+////////////////////////////////////////////////////////////////////////////////
+// An Archetype stores all entities that share the same component signature.
+// Its rows are split into fixed size chunks, and every chunk holds one packed
+// column per component (structure of arrays) plus a column of entity ids.
+// [ Row = position of an entity in the archetype ]
+// [ Chunk index = row / chunk capacity, Chunk slot = row % chunk capacity ]
+////////////////////////////////////////////////////////////////////////////////
+const size_t CHUNK_SIZE = 16 * 1024;
+const size_t CHUNK_ALIGNMENT = 64;
+
+// Type erased operations needed to move component data between archetypes.
+struct ComponentInfo {
+    size_t size = 0;
+    size_t alignment = 0;
+    void (*moveConstruct)(void *destination, void *source) = nullptr;
+    void (*destroy)(void *object) = nullptr;
+
+    template <typename T>
+    static ComponentInfo of() {
+        static_assert(alignof(T) <= CHUNK_ALIGNMENT, "Component alignment exceeds the chunk alignment");
+        ComponentInfo info;
+        info.size = sizeof(T);
+        info.alignment = alignof(T);
+        info.moveConstruct = [](void *destination, void *source) { new (destination) T(std::move(*static_cast<T *>(source))); };
+        info.destroy = [](void *object) { static_cast<T *>(object)->~T(); };
+        return info;
+    }
+};
+
+class Archetype {
+    private:
+        struct ChunkDeleter {
+            void operator ()(std::byte *chunk) const { ::operator delete(chunk, std::align_val_t(CHUNK_ALIGNMENT)); }
+        };
+
+        struct Column {
+            ComponentId componentId;
+            size_t offset;
+            ComponentInfo info;
+        };
+
+        ComponentSignature signature;
+        std::vector<Column> columns;
+        std::vector<int> columnPerComponentId;
+        std::vector<std::unique_ptr<std::byte, ChunkDeleter>> chunks;
+        size_t chunkBytes;
+        size_t chunkCapacity;
+        size_t size;
+
+        std::byte *getSlot(size_t row, const Column &column) const {
+            const auto chunk = chunks[row / chunkCapacity].get();
+            return chunk + column.offset + (row % chunkCapacity) * column.info.size;
+        }
+
+    public:
+        // Archetypes reached by adding or removing a single component
+        std::unordered_map<ComponentId, Archetype *> addEdges;
+        std::unordered_map<ComponentId, Archetype *> removeEdges;
+
+        Archetype(const ComponentSignature &signature, const std::vector<ComponentInfo> &componentInfos);
+        ~Archetype();
+
+        Archetype(const Archetype &) = delete;
+        Archetype &operator =(const Archetype &) = delete;
+
+        const ComponentSignature &getSignature() const { return signature; }
+        size_t getSize() const { return size; }
+        size_t getChunkCapacity() const { return chunkCapacity; }
+
+        size_t getChunkCount() const {
+            return (size + chunkCapacity - 1) / chunkCapacity;
+        }
+
+        size_t getChunkSize(size_t chunk) const {
+            return std::min(chunkCapacity, size - chunk * chunkCapacity);
+        }
+
+        bool hasColumn(ComponentId componentId) const {
+            return componentId < columnPerComponentId.size() && columnPerComponentId[componentId] >= 0;
+        }
+
+        Entity *getEntities(size_t chunk) const {
+            return reinterpret_cast<Entity *>(chunks[chunk].get());
+        }
+
+        // NOTE: The archetype must have a column for the component.
+        void *getColumn(size_t chunk, ComponentId componentId) const {
+            return chunks[chunk].get() + columns[columnPerComponentId[componentId]].offset;
+        }
+
+        // NOTE: The archetype must have a column for the component.
+        void *getComponent(size_t row, ComponentId componentId) const {
+            return getSlot(row, columns[columnPerComponentId[componentId]]);
+        }
+
+        Entity getEntity(size_t row) const {
+            return getEntities(row / chunkCapacity)[row % chunkCapacity];
+        }
+
+        // The bytes of the empty chunks past the growth slack
+        size_t getUnusedBytes() const {
+            const auto keptChunkCount = GROWTH_SLACK * getChunkCount();
+            return chunks.size() > keptChunkCount ? (chunks.size() - keptChunkCount) * chunkBytes : 0;
+        }
+
+        // Frees the empty chunks past the growth slack and returns the bytes
+        // freed.
+        size_t shrinkToFit();
+
+        // Appends a row for the entity and returns it. The components of the new
+        // row are left uninitialized and must be constructed by the caller.
+        size_t allocate(Entity entity);
+
+        // Moves every component the archetypes share from a row of the source
+        // archetype into a freshly allocated row of this archetype.
+        void moveFrom(Archetype &source, size_t sourceRow, size_t row);
+
+        // Destroys the components of the row and moves the last row into it.
+        // Returns the entity that now occupies the row, if any.
+        std::optional<Entity> remove(size_t row);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Archetype Storage
+////////////////////////////////////////////////////////////////////////////////
+// The Archetype Storage keeps components grouped by archetype instead of in a
+// pool per component type. Adding or removing a component moves the entity
+// to the archetype of its new signature.
+// [ Location index = entity index ]
+////////////////////////////////////////////////////////////////////////////////
+class ArchetypeStorage {
+    private:
+        struct EntityLocation {
+            Archetype *archetype = nullptr;
+            size_t row = 0;
+        };
+
+        std::vector<ComponentInfo> componentInfos;
+        std::unordered_map<ComponentSignature, std::unique_ptr<Archetype>> archetypesPerSignature;
+        std::vector<Archetype *> archetypes;
+        std::vector<EntityLocation> locations;
+
+        Archetype *getArchetype(const ComponentSignature &signature);
+        Archetype *getArchetypeWith(Archetype *archetype, ComponentId componentId);
+        Archetype *getArchetypeWithout(Archetype *archetype, ComponentId componentId);
+        void move(Entity entity, Archetype *destination);
+
+        template <typename TComponent> void registerComponent();
+
+        template <typename ...TComponents>
+        std::vector<const Archetype *> getMatchingArchetypes(const ComponentSignature &excluded) const;
+
+        template <typename ...TComponents, typename TFunction>
+        static void eachInChunk(const Archetype &archetype, size_t chunk, TFunction &function);
+
+        // The component of the row in the column, as it is handed out by views
+        template <typename TComponent>
+        static typename ViewComponent<TComponent>::Argument getArgument(const Archetype &archetype, typename ViewComponent<TComponent>::Type *column, size_t row) {
+            using Type = typename ViewComponent<TComponent>::Type;
+            if constexpr (ViewComponent<TComponent>::isTag && ViewComponent<TComponent>::isOptional) {
+                return archetype.getSignature().test(Component<Type>::getId()) ? &getTagInstance<Type>() : nullptr;
+            } else if constexpr (ViewComponent<TComponent>::isTag) {
+                return getTagInstance<Type>();
+            } else if constexpr (ViewComponent<TComponent>::isOptional) {
+                return column ? column + row : nullptr;
+            } else {
+                return column[row];
+            }
+        }
+
+    public:
+        ArchetypeStorage() = default;
+        ~ArchetypeStorage() = default;
+
+        size_t getArchetypeCount() const { return archetypes.size(); }
+
+        template <typename TComponent, typename ...TArgs> void add(Entity entity, TArgs &&...args);
+        template <typename TComponent> void remove(Entity entity);
+        template <typename TComponent> bool has(Entity entity) const;
+        template <typename TComponent> TComponent &get(Entity entity) const;
+        void destroy(Entity entity);
+
+        size_t getUnusedBytes() const;
+
+        // Frees the empty chunks of every archetype and the locations of the
+        // entity indices from entityCount on, which must not be stored.
+        // Returns the number of bytes freed.
+        size_t shrinkToFit(size_t entityCount);
+
+        // Calls function(entity, components...) or function(components...) for
+        // every entity that has all of the components and none of the excluded
+        // ones, one chunk at a time. The components may be Optional.
+        template <typename ...TComponents, typename TFunction>
+        void each(TFunction function, const ComponentSignature &excluded = ComponentSignature()) const;
+
+        // Same as each, but hands batches of whole chunks holding at least
+        // grainSize entities to the thread pool.
+        template <typename ...TComponents, typename TFunction>
+        void parallelEach(ThreadPool &threadPool, TFunction function, size_t grainSize, const ComponentSignature &excluded = ComponentSignature()) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// View
+////////////////////////////////////////////////////////////////////////////////
+// A View iterates over all entities that have every one of the requested
+// components. It walks the dense array of the smallest pool and looks up the
+// other pools directly, handing out references to the components.
+// Optional components are handed out as pointers and excluded components are
+// filtered out with the component signature of every entity, as are tags,
+// which have no pool to look up.
+////////////////////////////////////////////////////////////////////////////////
+template <typename ...TComponents>
+class View {
+    static_assert(((!ViewComponent<TComponents>::isOptional && !ViewComponent<TComponents>::isTag) || ...), "A view needs at least one component that is neither optional nor a tag");
+
+    friend class Coordinator;
+
+    private:
+        static constexpr bool HAS_TAGS = (ViewComponent<TComponents>::isTag || ...);
+        static constexpr ComponentSignature REQUIRED_TAGS = getRequiredTagSignature<TComponents...>();
+
+        std::tuple<Pool<typename ViewComponent<TComponents>::Type> *...> pools;
+        const SparseSet *entities;
+        const ArchetypeStorage *archetypes;
+
+        // Entities with any of the excluded components are skipped
+        // [ Array index = entity index ]
+        ComponentSignature excluded;
+        const ComponentSignature *signatures;
+
+        // A component of the entity must have been added or changed after the
+        // since tick. Entities without the component never pass.
+        struct TickFilter {
+            const void *pool;
+            bool (*isNewer)(const void *pool, Entity entity, Tick sinceTick);
+        };
+        std::vector<TickFilter> tickFilters;
+        Tick sinceTick;
+
+        // The entity must belong to every one of the groups
+        std::vector<const SparseSet *> groupFilters;
+
+        size_t getCandidateCount() const {
+            return entities ? entities->getSize() : 0;
+        }
+
+        bool containsAll(Entity entity) const {
+            return std::apply([entity](auto *...pool) {
+                return ((ViewComponent<TComponents>::isOptional || ViewComponent<TComponents>::isTag || pool->contains(entity)) && ...);
+            }, pools);
+        }
+
+        bool matches(Entity entity) const {
+            if (!containsAll(entity)) {
+                return false;
+            }
+            if (signatures) {
+                const auto &signature = signatures[entity.getIndex()];
+                if (signature.intersects(excluded) || !signature.contains(REQUIRED_TAGS)) {
+                    return false;
+                }
+            }
+            for (const auto &filter : tickFilters) {
+                if (!filter.isNewer(filter.pool, entity, sinceTick)) {
+                    return false;
+                }
+            }
+            return belongsToGroups(entity);
+        }
+
+        bool belongsToGroups(Entity entity) const {
+            for (const auto groupEntities : groupFilters) {
+                if (!groupEntities->contains(entity)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Wraps the function of each for archetype storage, which does not
+        // know about groups, so it skips the entities outside of the groups
+        template <typename TFunction>
+        auto withGroupFilters(TFunction &function) const {
+            return [this, &function](Entity entity, typename ViewComponent<TComponents>::Argument ...arguments) {
+                if (!belongsToGroups(entity)) {
+                    return;
+                }
+                if constexpr (std::is_invocable_v<TFunction, Entity, typename ViewComponent<TComponents>::Argument...>) {
+                    function(entity, arguments...);
+                } else {
+                    function(arguments...);
+                }
+            };
+        }
+
+        template <typename TComponent, typename TPool>
+        typename ViewComponent<TComponent>::Argument getArgument(TPool *pool, Entity entity) const {
+            using Type = typename ViewComponent<TComponent>::Type;
+            if constexpr (ViewComponent<TComponent>::isTag && ViewComponent<TComponent>::isOptional) {
+                return signatures[entity.getIndex()].test(Component<Type>::getId()) ? &getTagInstance<Type>() : nullptr;
+            } else if constexpr (ViewComponent<TComponent>::isTag) {
+                return getTagInstance<Type>();
+            } else if constexpr (ViewComponent<TComponent>::isOptional) {
+                return pool && pool->contains(entity) ? &pool->get(entity) : nullptr;
+            } else {
+                return pool->get(entity);
+            }
+        }
+
+        template <typename TComponent, Tick (Pool<TComponent>::*getTick)(Entity) const>
+        View withTickFilter() const {
+            static_assert(!isTagComponent<TComponent>, "Tags have no pool to track changes in");
+            if (archetypes) {
+                throw std::logic_error("Change tracking is only supported for views over pools");
+            }
+            View view = *this;
+            const auto pool = std::get<Pool<TComponent> *>(pools);
+            if (!pool) {
+                // Only an optional component can have no pool, then no entity
+                // has a change to report
+                view.entities = nullptr;
+                return view;
+            }
+            view.tickFilters.push_back({ pool, [](const void *pool, Entity entity, Tick sinceTick) {
+                // An optional component may be missing
+                const auto componentPool = static_cast<const Pool<TComponent> *>(pool);
+                return componentPool->contains(entity) && isNewerTick((componentPool->*getTick)(entity), sinceTick);
+            } });
+            return view;
+        }
+
+        template <typename TFunction>
+        void eachInRange(size_t begin, size_t end, TFunction &function) const {
+            for (size_t i = begin; i < end; i++) {
+                const auto entity = (*entities)[i];
+                if (!matches(entity)) {
+                    continue;
+                }
+                std::apply([&](auto *...pool) {
+                    if constexpr (std::is_invocable_v<TFunction, Entity, typename ViewComponent<TComponents>::Argument...>) {
+                        function(entity, getArgument<TComponents>(pool, entity)...);
+                    } else {
+                        function(getArgument<TComponents>(pool, entity)...);
+                    }
+                }, pools);
+            }
+        }
+
+    public:
+        class Iterator {
+            private:
+                const View *view;
+                size_t index;
+
+                void skip() {
+                    while (index < view->getCandidateCount() && !view->matches((*view->entities)[index])) {
+                        index++;
+                    }
+                }
+
+            public:
+                Iterator(const View *view, size_t index) : view(view), index(index) { skip(); }
+
+                std::tuple<Entity, typename ViewComponent<TComponents>::Argument...> operator *() const {
+                    const auto entity = (*view->entities)[index];
+                    return std::apply([this, entity](auto *...pool) {
+                        return std::tuple<Entity, typename ViewComponent<TComponents>::Argument...>(
+                            entity, view->template getArgument<TComponents>(pool, entity)...
+                        );
+                    }, view->pools);
+                }
+
+                Iterator &operator ++() {
+                    index++;
+                    skip();
+                    return *this;
+                }
+
+                bool operator ==(const Iterator &other) const { return index == other.index; }
+                bool operator !=(const Iterator &other) const { return index != other.index; }
+        };
+
+        View(Pool<typename ViewComponent<TComponents>::Type> *...componentPools)
+            : pools(componentPools...), entities(nullptr), archetypes(nullptr), signatures(nullptr), sinceTick(0) {
+            // The view is empty if any of the required component types has no pool
+            if (((!ViewComponent<TComponents>::isOptional && !ViewComponent<TComponents>::isTag && !componentPools) || ...)) {
+                return;
+            }
+            // Walk the smallest pool of the required components
+            auto selectCandidates = [this](const SparseSet &candidate) {
+                if (!entities || candidate.getSize() < entities->getSize()) {
+                    entities = &candidate;
+                }
+            };
+            ((ViewComponent<TComponents>::isOptional || ViewComponent<TComponents>::isTag ? void() : selectCandidates(componentPools->getEntities())), ...);
+        }
+
+        // A view over archetype storage can only be iterated with each and
+        // parallelEach, begin throws std::logic_error.
+        View(const ArchetypeStorage *archetypes)
+            : pools(), entities(nullptr), archetypes(archetypes), signatures(nullptr), sinceTick(0) {}
+
+        // Returns a view of the entities whose component was changed or added
+        // after the since tick. Views created while a system runs compare
+        // against the tick at the end of the system's last run, so every
+        // system sees each change once and does not see its own changes.
+        // NOTE: Only changes made with Coordinator::getMutableComponent are
+        // tracked, and only in pools. Throws std::logic_error for a view over
+        // archetype storage.
+        template <typename TComponent>
+        View changed() const {
+            return withTickFilter<TComponent, &Pool<TComponent>::getChangedTick>();
+        }
+
+        // Returns a view of the entities whose component was added after the
+        // since tick.
+        template <typename TComponent>
+        View added() const {
+            return withTickFilter<TComponent, &Pool<TComponent>::getAddedTick>();
+        }
+
+        // Returns a view whose changed and added filters compare against the
+        // given tick instead.
+        View since(Tick tick) const {
+            View view = *this;
+            view.sinceTick = tick;
+            return view;
+        }
+
+        // Returns a view of the entities that also belong to the group, see
+        // Coordinator::getEntitiesByGroup. Walks the members of the group
+        // instead if there are fewer of them than in the smallest pool.
+        // NOTE: The group must outlive the view.
+        View inGroup(const SparseSet &groupEntities) const {
+            View view = *this;
+            view.groupFilters.push_back(&groupEntities);
+            if (view.entities && groupEntities.getSize() < view.entities->getSize()) {
+                view.entities = &groupEntities;
+            }
+            return view;
+        }
+
+        Iterator begin() const {
+            if (archetypes) {
+                throw std::logic_error("Range-for is only supported for views over pools");
+            }
+            return Iterator(this, 0);
+        }
+        Iterator end() const { return Iterator(this, getCandidateCount()); }
+
+        // Calls function(entity, components...) or function(components...) for
+        // every entity in the view.
+        template <typename TFunction>
+        void each(TFunction function) const {
+            if (archetypes && groupFilters.empty()) {
+                archetypes->each<TComponents...>(function, excluded);
+                return;
+            }
+            if (archetypes) {
+                archetypes->each<TComponents...>(withGroupFilters(function), excluded);
+                return;
+            }
+            eachInRange(0, getCandidateCount(), function);
+        }
 
-template <typename T>
-struct Component : public IComponent {
-    static ComponentId getId() {
-        static auto id = nextId++;
-        return id;
-    }
+        // Same as each, but splits the view into ranges of at least grainSize
+        // entities that are run on the thread pool. The function is called
+        // from several threads at once and must only touch the components of
+        // the entity it was called for.
+        template <typename TFunction>
+        void parallelEach(ThreadPool &threadPool, TFunction function, size_t grainSize = DEFAULT_GRAIN_SIZE) const {
+            if (archetypes && groupFilters.empty()) {
+                archetypes->parallelEach<TComponents...>(threadPool, function, grainSize, excluded);
+                return;
+            }
+            if (archetypes) {
+                archetypes->parallelEach<TComponents...>(threadPool, withGroupFilters(function), grainSize, excluded);
+                return;
+            }
+            threadPool.parallelFor(getCandidateCount(), grainSize, [this, &function](size_t begin, size_t end) {
+                eachInRange(begin, end, function);
+            });
+        }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
-// Pool
+// Owning Group
 ////////////////////////////////////////////////////////////////////////////////
-// A Pool is a vector of objects of type T
+// An Owning Group keeps the entities that have all of its components at the
+// front of the pools it owns, in the same order in every owned pool. Iterating
+// the group is a walk over the first getSize() elements of the owned pools,
+// without any sparse set lookups.
+// The group is kept up to date with O(1) swaps when a component is added or
+// removed. A pool can only be owned by one group, other groups can still
+// observe its components, which are then looked up per entity:
+//     coordinator.owningGroup<TransformComponent, RigidBodyComponent>();
+//     coordinator.owningGroup<SpriteComponent>(Observe<TransformComponent>());
+// [ Pool index < group size = entity is in the group ]
 ////////////////////////////////////////////////////////////////////////////////
-class IPool {
-    public:
-        virtual ~IPool() = default;
-        virtual void remove(EntityId entityId) = 0;
-};
+template <typename ...TComponents>
+struct Observe {};
 
-template <typename T>
-class Pool : public IPool {
+// The type erased state of a group that the coordinator keeps up to date.
+class OwningGroupData {
     private:
-        std::vector<T> data;
-        int size;
-
-        std::unordered_map<int, int> entityIdToIndex;
-        std::unordered_map<int, int> indexToEntityId;
+        ComponentSignature ownedSignature;
+        ComponentSignature signature;
+        std::vector<IPool *> ownedPools;
+        size_t size;
 
     public:
-        Pool(int capacity = 100) {
-            size = 0;
-            data.resize(capacity);
-        }
+        OwningGroupData(const ComponentSignature &ownedSignature, const ComponentSignature &signature, std::vector<IPool *> ownedPools);
 
-        virtual ~Pool() = default;
+        // The components the group owns
+        const ComponentSignature &getOwnedSignature() const { return ownedSignature; }
 
-        bool isEmpty() const {
-            return size == 0;
-        }
+        // The components the group owns and observes
+        const ComponentSignature &getSignature() const { return signature; }
 
-        int getSize() const {
-            return size;
-        }
+        size_t getSize() const { return size; }
 
-        void resize(int n) {
-            data.resize(n);
-        }
+        bool contains(Entity entity) const;
 
-        void clear() {
-            data.clear();
-            size = 0;
-        }
+        // Moves the entity into the group if its signature has all the
+        // components of the group.
+        void onComponentAdded(Entity entity, const ComponentSignature &entitySignature);
 
-        void set(int entityId, T object) {
-            if (entityIdToIndex.find(entityId) != entityIdToIndex.end()) {
-                // If the element already exists, simply replace the object
-                int index = entityIdToIndex.at(entityId);
-                data[index] = object;
-            } else {
-                int index = size;
-                entityIdToIndex.emplace(entityId, index);
-                indexToEntityId.emplace(index, entityId);
+        // Moves the entity out of the group before one of its components is
+        // removed.
+        void onComponentRemoved(Entity entity);
+};
 
-                // If necessary, resize the current capacity of the data vector
-                if (index >= static_cast<int>(data.capacity())) {
-                    data.resize(size * 2);
-                }
+template <typename TObserved, typename ...TOwned>
+class OwningGroup;
 
-                data[index] = object;
-                size++;
+template <typename ...TObserved, typename ...TOwned>
+class OwningGroup<Observe<TObserved...>, TOwned...> {
+    private:
+        const OwningGroupData *group;
+        std::tuple<Pool<TOwned> *...> ownedPools;
+        std::tuple<Pool<TObserved> *...> observedPools;
+        const ArchetypeStorage *archetypes;
+
+        template <typename TFunction>
+        void eachInRange(size_t begin, size_t end, TFunction &function) const {
+            const Entity *entities = std::get<0>(ownedPools)->getEntities().data();
+            const auto owned = std::apply([](auto *...pool) { return std::make_tuple(pool->getData()...); }, ownedPools);
+            for (size_t i = begin; i < end; i++) {
+                std::apply([&](auto *...ownedData) {
+                    std::apply([&](auto *...observedPool) {
+                        if constexpr (std::is_invocable_v<TFunction, Entity, TOwned &..., TObserved &...>) {
+                            function(entities[i], ownedData[i]..., observedPool->get(entities[i])...);
+                        } else {
+                            function(ownedData[i]..., observedPool->get(entities[i])...);
+                        }
+                    }, observedPools);
+                }, owned);
             }
         }
 
-        void remove(EntityId entityId) override {
-            if (entityIdToIndex.find(entityId) == entityIdToIndex.end()) {
-                return;
-            }
-
-            int indexOfRemoved = entityIdToIndex.at(entityId);
-            int indexOfLast = size - 1;
-            data[indexOfRemoved] = data[indexOfLast];
+    public:
+        OwningGroup(const OwningGroupData *group, Pool<TOwned> *...ownedPools, Pool<TObserved> *...observedPools)
+            : group(group), ownedPools(ownedPools...), observedPools(observedPools...), archetypes(nullptr) {}
 
-            int entityIdOfLast = indexToEntityId[indexOfLast];
-            entityIdToIndex[entityIdOfLast] = indexOfRemoved;
-            indexToEntityId[indexOfRemoved] = entityIdOfLast;
-            
-            entityIdToIndex.erase(entityId);
-            indexToEntityId.erase(indexOfLast);
+        // Archetypes already store their components packed, so a group over
+        // archetype storage simply iterates the matching archetypes.
+        OwningGroup(const ArchetypeStorage *archetypes) : group(nullptr), ownedPools(), observedPools(), archetypes(archetypes) {}
 
-            size--;
+        // NOTE: Only groups over pools know their size.
+        size_t getSize() const {
+            return group ? group->getSize() : 0;
         }
 
-        T &get(int entityId) {
-            return static_cast<T&>(data[entityIdToIndex[entityId]]);
-
-            // FIXME: What happens if entityId is not found?
-            // NOTE: Can use pointer instead of reference as return type and
-            // return nullptr.
-            // auto index = entityIdToIndex.find(entityId);
-            // if (index != entityIdToIndex.end()) {
-            //     return static_cast<T&>(data[index->second]);
-            // } else {
-            //     return nullptr;
-            // }
+        // Calls function(entity, owned..., observed...) or
+        // function(owned..., observed...) for every entity in the group.
+        template <typename TFunction>
+        void each(TFunction function) const {
+            if (archetypes) {
+                archetypes->each<TOwned..., TObserved...>(function, DISABLED_SIGNATURE);
+                return;
+            }
+            eachInRange(0, getSize(), function);
         }
 
-        T &operator [](int index) {
-            return data[index];
+        // Same as each, but splits the group into ranges of at least grainSize
+        // entities that are run on the thread pool.
+        template <typename TFunction>
+        void parallelEach(ThreadPool &threadPool, TFunction function, size_t grainSize = DEFAULT_GRAIN_SIZE) const {
+            if (archetypes) {
+                archetypes->parallelEach<TOwned..., TObserved...>(threadPool, function, grainSize, DISABLED_SIGNATURE);
+                return;
+            }
+            threadPool.parallelFor(getSize(), grainSize, [this, &function](size_t begin, size_t end) {
+                eachInRange(begin, end, function);
+            });
         }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 // System
 ////////////////////////////////////////////////////////////////////////////////
-// 
+// A System declares the components its entities require, and the components
+// it reads and writes while updating. The access declarations let the
+// Coordinator run systems that do not conflict at the same time.
+// The entities of a system are kept in a sparse set, so they can be added and
+// removed in constant time and iterated as one packed array.
 ////////////////////////////////////////////////////////////////////////////////
+class Coordinator;
+
 class System {
     private:
         ComponentSignature componentSignature;
-        std::vector<Entity> entities;
+        ComponentSignature excludeSignature = DISABLED_SIGNATURE;
+        ComponentSignature readSignature;
+        ComponentSignature writeSignature;
+        bool hasDeclaredAccess = false;
+        bool enabled = true;
+        SparseSet entities;
+
+        // The change tick at the end of the last run of the system
+        Tick lastRunTick = 0;
     
     public:
         System() = default;
-        ~System() = default;
+        virtual ~System() = default;
 
+        // Called once per frame by Coordinator::updateSystems, possibly on a
+        // worker thread and at the same time as other non-conflicting systems.
+        virtual void update(Coordinator &coordinator, double deltaTime) {}
+
+        void reserve(size_t n);
         void addEntityToSystem(Entity entity);
         void removeEntityToSystem(Entity entity);
-        std::vector<Entity> getSystemEntities() const;
-        const ComponentSignature getComponentSignature() const;
+        bool hasEntity(Entity entity) const;
+        const SparseSet &getSystemEntities() const;
+        size_t shrinkToFit();
+        const ComponentSignature &getComponentSignature() const;
+        const ComponentSignature &getExcludeSignature() const;
+        const ComponentSignature &getReadSignature() const;
+        const ComponentSignature &getWriteSignature() const;
+
+        Tick getLastRunTick() const { return lastRunTick; }
+        void setLastRunTick(Tick tick) { lastRunTick = tick; }
+
+        // A disabled system is skipped by Coordinator::updateSystems, but its
+        // entities are still kept up to date, so it can be enabled again at
+        // no cost.
+        bool isEnabled() const { return enabled; }
+        void setEnabled(bool enabled) { this->enabled = enabled; }
+
+        // Two systems conflict if one writes a component the other reads or
+        // writes. A system that never declared its access conflicts with all.
+        bool conflictsWith(const System &other) const;
+
+        // An entity belongs to the system if its signature has all of the
+        // required components and none of the excluded components.
+        bool matches(const ComponentSignature &signature) const;
+
+        // Checks if a change of the given component bits can add the entity
+        // to the system or remove it from the system.
+        bool isAffectedBy(const ComponentSignature &changedBits) const;
 
         template <typename TComponent> void requireComponent();
+        template <typename TComponent> void excludeComponent();
+        template <typename TComponent> void readComponent();
+        template <typename TComponent> void writeComponent();
+
+        // Calls function(entity) for every entity of the system, split into
+        // ranges of at least grainSize entities that are run on the thread
+        // pool. The function is called from several threads at once.
+        template <typename TFunction>
+        void parallelEach(ThreadPool &threadPool, TFunction function, size_t grainSize = DEFAULT_GRAIN_SIZE) const {
+            threadPool.parallelFor(entities.getSize(), grainSize, [this, &function](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    function(entities[i]);
+                }
+            });
+        }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Command Buffer
+////////////////////////////////////////////////////////////////////////////////
+// A Command Buffer records structural changes (creating and destroying
+// entities, adding and removing components) so they can be requested from
+// worker threads while systems run. Component values are moved into a linear
+// arena of fixed size blocks. All command buffers are played back in one
+// batch, sorted by entity, by Coordinator::update.
+// NOTE: Every thread records into its own command buffer, see
+// Coordinator::getCommandBuffer.
+////////////////////////////////////////////////////////////////////////////////
+class CommandBuffer {
+    public:
+        enum class CommandType {
+            Create,
+            Destroy,
+            AddComponent,
+            RemoveComponent
+        };
+
+        struct Command {
+            CommandType type;
+            Entity entity;
+            // The component value in the arena, only used to add components
+            void *component;
+            // Adds or removes the component of the command
+            void (*apply)(Coordinator &coordinator, Entity entity, void *component);
+            void (*destroy)(void *component);
+        };
+
+    private:
+        static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+        Coordinator &coordinator;
+        std::vector<Command> commands;
+
+        std::vector<std::unique_ptr<std::byte[]>> blocks;
+        std::vector<size_t> blockSizes;
+        size_t currentBlock;
+        size_t blockOffset;
+
+        void *allocate(size_t size, size_t alignment);
+
+    public:
+        CommandBuffer(Coordinator &coordinator);
+        ~CommandBuffer();
+
+        CommandBuffer(const CommandBuffer &) = delete;
+        CommandBuffer &operator =(const CommandBuffer &) = delete;
+
+        bool isEmpty() const { return commands.empty(); }
+        size_t getSize() const { return commands.size(); }
+        const std::vector<Command> &getCommands() const { return commands; }
+
+        // Reserves the entity right away, it can be used in later commands
+        // and becomes part of the systems when the buffer is played back.
+        Entity create();
+        void destroy(Entity entity);
+        template <typename TComponent, typename ...TArgs> void addComponent(Entity entity, TArgs &&...args);
+        template <typename TComponent> void removeComponent(Entity entity);
+
+        // Destroys all recorded commands, keeping the arena for reuse
+        void clear();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Prefab
+////////////////////////////////////////////////////////////////////////////////
+// A Prefab captures the component values of an entity recipe once, together
+// with its component signature, so that Coordinator::instantiate can stamp
+// out many copies of it in bulk.
+// Components are copied into the new entities, so they must be copyable.
+////////////////////////////////////////////////////////////////////////////////
+class Prefab {
+    friend class Coordinator;
+
+    private:
+        struct PrefabComponent {
+            ComponentId componentId;
+            std::shared_ptr<const void> component;
+            // Adds a copy of the component to every entity of the range
+            void (*instantiate)(Coordinator &coordinator, const void *component, const EntityRange &entities);
+        };
+
+        ComponentSignature signature;
+        std::vector<PrefabComponent> components;
+
+    public:
+        // Sets the value of a component of the prefab, replacing the old
+        // value if the prefab already has the component.
+        template <typename TComponent, typename ...TArgs> Prefab &addComponent(TArgs &&...args);
+
+        const ComponentSignature &getSignature() const { return signature; }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -228,55 +1543,225 @@ class System {
 ////////////////////////////////////////////////////////////////////////////////
 // 
 ////////////////////////////////////////////////////////////////////////////////
+enum class StorageBackend {
+    // A sparse set pool per component type
+    Pools,
+    // Chunks of entities grouped by component signature
+    Archetypes
+};
+
 class Coordinator {
+    friend class Prefab;
+
     private:
+        StorageBackend storageBackend;
+
         ////////////////////////////////////////////////////////////////////////
         // Entity management
         ////////////////////////////////////////////////////////////////////////
-        size_t numEntites = 0;
-        std::set<Entity> entitiesToBeCreated;
-        std::set<Entity> entitiesToBeDestroyed;
+        // The number of entity indices handed out so far, including indices
+        // reserved by command buffers on worker threads
+        std::atomic<EntityId> numEntites = 0;
+        std::vector<Entity> entitiesToBeCreated;
+        std::vector<Entity> entitiesToBeDestroyed;
         std::deque<EntityId> freeIds;
+        // Guards the free indices, command buffers on worker threads reuse
+        // them while reserving
+        std::mutex freeIdsMutex;
+
+        // Prefab instances waiting to be added to the systems, all entities
+        // of a range are matched against the systems at once
+        struct PrefabInstances {
+            EntityRange entities;
+            ComponentSignature signature;
+        };
+        std::vector<PrefabInstances> prefabInstancesToBeCreated;
+
+        // Hands out n entity indices, reusing free indices first
+        EntityRange reserveRange(size_t n);
+        // Thread safe, takes n indices that were never handed out and
+        // returns the first, throws std::length_error if the entity index
+        // bits run out
+        EntityId takeFreshIndices(size_t n);
+        void addPrefabInstancesToSystems(const PrefabInstances &instances);
+
+        template <typename TComponent> void addComponentCopies(const EntityRange &entities, const TComponent &component);
+
+        // The current generation of every entity slot
+        // [ Vector index = entity index ]
+        std::vector<uint16_t> entityGenerations;
 
         ////////////////////////////////////////////////////////////////////////
         // Component management 
         ////////////////////////////////////////////////////////////////////////
-        // A vector of component pools, each pool contains all the data for a
-        // certain component type.
-        // [ Vector index = component type id ]
-        // [ Pool index = entity id ]
-        std::vector<std::shared_ptr<IPool>> componentPools;
+        // An array of component pools, each pool contains all the data for a
+        // certain component type. Pools are created on first use.
+        // [ Array index = component type id ]
+        // [ Pool index = entity index ]
+        std::array<std::unique_ptr<IPool>, MAX_COMPONENTS> componentPools;
+
+        // The entities being destroyed, collected per pool so each pool is
+        // compacted once. Kept around to reuse the allocations.
+        // [ Array index = component type id ]
+        std::array<std::vector<Entity>, MAX_COMPONENTS> entitiesToRemovePerPool;
+
+        // Only used by the archetype storage backend, replaces component pools
+        ArchetypeStorage archetypes;
+
+        // The owning groups over the component pools, and the components
+        // whose pools are owned by one of them
+        std::vector<std::unique_ptr<OwningGroupData>> owningGroups;
+        ComponentSignature ownedComponents;
+
+        void addToOwningGroups(Entity entity, ComponentId componentId);
+        void addToOwningGroups(Entity entity, const ComponentSignature &addedComponents);
+        void removeFromOwningGroups(Entity entity, const ComponentSignature &removedComponents);
 
         ////////////////////////////////////////////////////////////////////////
         // System management 
         ////////////////////////////////////////////////////////////////////////
         std::unordered_map<std::type_index, std::shared_ptr<System>> systems;
 
+        // The systems in the order they were added, which is the order
+        // conflicting systems are run in
+        std::vector<std::shared_ptr<System>> systemsInOrder;
+
+        // The fixed pool of worker threads the systems are run on
+        ThreadPool threadPool;
+
+        // Bumped at the end of every system run, components added or
+        // changed are stamped with the current tick
+        std::atomic<Tick> changeTick = 1;
+
+        // The last run tick of the system running on the calling thread, the
+        // tick views created by the system compare changes against
+        static Tick getRunningSystemLastRunTick();
+
+        ////////////////////////////////////////////////////////////////////////
+        // Deferred structural changes
+        ////////////////////////////////////////////////////////////////////////
+        // [ Vector index = thread index ]
+        std::vector<std::unique_ptr<CommandBuffer>> commandBuffers;
+
+        void assureEntitySlots(EntityId entityIndex);
+        void playbackCommandBuffers();
+
         ////////////////////////////////////////////////////////////////////////
         // Entity-Component-System management
         ////////////////////////////////////////////////////////////////////////
         // A vector of component signatures for each entity, indicating which
-        // component is turned "on" for each entity.
-        // [ Vector index = entity id ]
-        std::vector<ComponentSignature> entityComponentSignatures;
+        // component is turned "on" for each entity. It grows without copying
+        // and views can keep a pointer to it.
+        // [ Vector index = entity index ]
+        VirtualVector<ComponentSignature, MAX_ENTITIES> entityComponentSignatures;
+
+        // Entities whose signature changed after they were added to the
+        // systems, together with their signature before the first change.
+        // Their system membership is updated in the next update.
+        struct SignatureChange {
+            Entity entity;
+            ComponentSignature previousSignature;
+        };
+        std::vector<SignatureChange> signatureChanges;
+
+        // Per entity bookkeeping flags
+        // [ Vector index = entity index ]
+        enum EntityFlag : uint8_t {
+            // The entity is waiting to be matched against the systems, either
+            // because it was just created or because its signature changed
+            ENTITY_PENDING_SYNC = 1 << 0,
+            // The entity was matched against the systems at least once
+            ENTITY_IN_SYSTEMS = 1 << 1,
+            // The entity was created and not destroyed yet. Indices reserved
+            // by a command buffer get it when the buffer is played back.
+            ENTITY_ALIVE = 1 << 2
+        };
+        std::vector<uint8_t> entityFlags;
+
+        size_t disabledEntityCount = 0;
+
+        // Unused bytes above which update compacts the coordinator, 0 if
+        // it is only compacted explicitly
+        size_t compactBudget = 0;
+
+        // Releases the entity slots past the last index that is in use
+        size_t shrinkEntitySlots();
+
+        void setComponentBit(Entity entity, ComponentId componentId, bool value);
+        void addComponentBits(Entity entity, const ComponentSignature &componentBits);
+        void syncSignatureChanges();
+        void addEntitiesToSystem(System &system);
+        void destroyEntities();
         
         ////////////////////////////////////////////////////////////////////////
         // Tag and Group management
         ////////////////////////////////////////////////////////////////////////
-        std::unordered_map<std::string, Entity> entityPerTag;
-        std::unordered_map<EntityId, std::string> tagPerEntityId;
-        std::unordered_map<std::string, std::set<Entity>> entitiesPerGroup;
-        std::unordered_map<EntityId, std::set<std::string>> groupsPerEntityId;
+        // Tag name hashes interned to tag ids
+        std::unordered_map<uint64_t, TagId> tagIds;
+        // The name and the tagged entity of every tag
+        // [ Vector index = tag id ]
+        std::vector<std::string> tagNames;
+        std::vector<std::optional<Entity>> entityPerTag;
+        // The tag of every entity, or NULL_TAG
+        // [ Vector index = entity index ]
+        std::vector<TagId> tagPerEntity;
+
+        // Group names interned to group ids
+        std::unordered_map<std::string, GroupId> groupIds;
+        // The members of every group
+        // [ Array index = group id ]
+        std::array<SparseSet, MAX_GROUPS> entitiesPerGroup;
+        // The groups every entity belongs to
+        // [ Vector index = entity index ]
+        std::vector<GroupSignature> groupsPerEntity;
+
+        template <typename TComponent> Pool<TComponent> *getPool() const;
+        template <typename TComponent> Pool<TComponent> *assurePool();
     
     public:
-        Coordinator();
+        Coordinator(
+            StorageBackend storageBackend = StorageBackend::Pools,
+            size_t workerCount = ThreadPool::getDefaultWorkerCount()
+        );
         ~Coordinator();
 
+        StorageBackend getStorageBackend() const { return storageBackend; }
+        ThreadPool &getThreadPool() { return threadPool; }
+
         ////////////////////////////////////////////////////////////////////////
         // Entity management
         ////////////////////////////////////////////////////////////////////////
+        // The creating functions throw std::length_error once all
+        // MAX_ENTITIES entity indices are in use
         Entity create();
+        // Creates n entities at once
+        EntityRange create(size_t n);
+
+        // Creates n entities with a copy of the components of the prefab.
+        // With pool storage the components are copied into every pool in one
+        // pass, and the entities join their systems in one batch per system
+        // in the next update.
+        EntityRange instantiate(const Prefab &prefab, size_t n = 1);
         void destroy(Entity entity);
+        // NOTE: Entities created by a command buffer are only alive once the
+        // buffer was played back in the next update.
+        bool isAlive(Entity entity) const;
+
+        // A disabled entity keeps its components in place, but is skipped by
+        // systems, views and owning groups until it is enabled again. Like
+        // component changes, systems see the change in the next update.
+        // NOTE: With archetype storage the entity moves to the archetype with
+        // the Disabled tag.
+        void disable(Entity entity);
+        void enable(Entity entity);
+        bool isEnabled(Entity entity) const;
+
+        // Thread safe, reserves an entity index for a command buffer, reusing
+        // free indices first
+        Entity reserve();
+
+        // The command buffer of the calling thread
+        CommandBuffer &getCommandBuffer();
 
         ////////////////////////////////////////////////////////////////////////
         // Component management
@@ -286,6 +1771,32 @@ class Coordinator {
         template <typename TComponent> bool hasComponent(Entity entity) const;
         template <typename TComponent> TComponent &getComponent(Entity entity) const;
 
+        // Adds the components returned by generator(entity), a std::tuple of
+        // all of them, to every entity of an EntityRange or SparseSet. Each
+        // pool is grown once up front and filled in a single loop. Entities
+        // that are not alive are skipped without calling the generator.
+        template <typename ...TComponents, typename TEntities, typename TGenerator>
+        void addComponents(const TEntities &entities, TGenerator generator);
+
+        // Same as getComponent, but marks the component as changed for the
+        // changed<T>() filter of views
+        template <typename TComponent> TComponent &getMutableComponent(Entity entity);
+        Tick getChangeTick() const { return changeTick.load(std::memory_order_relaxed); }
+
+        // Returns a view of the entities with all of the components, which
+        // may be Optional, and none of the excluded components
+        template <typename ...TComponents, typename ...TExcluded>
+        View<TComponents...> view(Exclude<TExcluded...> = {}) const;
+
+        // Returns the owning group of the given components, creating it on
+        // first use. Throws std::logic_error if one of the pools is already
+        // owned by another group, a second group over a shared component has
+        // to observe it instead, e.g. owningGroup<SpriteComponent>(
+        // Observe<TransformComponent>()) next to owningGroup<TransformComponent,
+        // RigidBodyComponent>().
+        template <typename ...TOwned, typename ...TObserved>
+        OwningGroup<Observe<TObserved...>, TOwned...> owningGroup(Observe<TObserved...> = {});
+
         ////////////////////////////////////////////////////////////////////////
         // System management
         ////////////////////////////////////////////////////////////////////////
@@ -293,6 +1804,14 @@ class Coordinator {
         template <typename TSystem> void removeSystem();
         template <typename TSystem> bool hasSystem() const;
         template <typename TSystem> TSystem &getSystem() const;
+        template <typename TSystem> void enableSystem();
+        template <typename TSystem> void disableSystem();
+
+        // Runs the update of every system. Systems whose declared component
+        // access does not conflict run in parallel on the thread pool.
+        // NOTE: Systems must not create or destroy entities or add or remove
+        // components while they run in parallel.
+        void updateSystems(double deltaTime);
 
         ////////////////////////////////////////////////////////////////////////
         // Entity-System management
@@ -303,19 +1822,68 @@ class Coordinator {
         ////////////////////////////////////////////////////////////////////////
         // Tag and Group management
         ////////////////////////////////////////////////////////////////////////
+        // Returns the id of the tag, interning the name on first use. The id
+        // can be kept around and passed to the overloads below, which skip
+        // hashing the name.
+        TagId getTagId(const TagKey &tag);
+        const std::string &getTagName(TagId tag) const { return tagNames[tag]; }
+
+        // Tags the entity, replacing its previous tag and untagging the
+        // entity that had the tag before.
+        void tagEntity(Entity entity, TagId tag);
         void tagEntity(Entity entity, const std::string &tag);
+        bool entityHasTag(Entity entity, TagId tag) const;
         bool entityHasTag(Entity entity, const std::string &tag) const;
+        std::optional<Entity> getEntityByTag(TagId tag) const;
         std::optional<Entity> getEntityByTag(const std::string &tag) const;
+        // Returns the tag of the entity, or NULL_TAG
+        TagId getEntityTag(Entity entity) const;
         void removeEntityTag(Entity entity);
+        void removeTag(TagId tag);
         void removeTag(const std::string &tag);
 
+        // Returns the id of the group, interning the name on first use. The
+        // id overloads below skip hashing the name. Throws std::length_error
+        // if there are MAX_GROUPS groups already.
+        GroupId getGroupId(const std::string &group);
+
+        void groupEntity(Entity entity, GroupId group);
         void groupEntity(Entity entity, const std::string &group);
-        bool entityBelongsToGroup(Entity entity, const std::string &group);
-        std::vector<Entity> getEntitiesByGroup(const std::string &group);
+        bool entityBelongsToGroup(Entity entity, GroupId group) const;
+        bool entityBelongsToGroup(Entity entity, const std::string &group) const;
+        // The members of the group, which can be iterated in place or passed
+        // to View::inGroup. The reference stays valid for the lifetime of the
+        // coordinator.
+        const SparseSet &getEntitiesByGroup(GroupId group) const;
+        const SparseSet &getEntitiesByGroup(const std::string &group);
+        void removeEntityGroup(Entity entity, GroupId group);
         void removeEntityGroup(Entity entity, const std::string &group);
         void removeEntityGroups(Entity entity);
+        void removeGroup(GroupId group);
         void removeGroup(const std::string &group);
         
+        ////////////////////////////////////////////////////////////////////////
+        // Memory management
+        ////////////////////////////////////////////////////////////////////////
+        // Gives the memory that was left behind by destroyed entities and
+        // removed components back: the capacity of the pools or archetype
+        // chunks past their growth slack (see GROWTH_SLACK), sparse pages
+        // without entities, and the entity slots past the last index in use.
+        // Returns the number of bytes released.
+        // NOTE: Must not be called while systems are running. It is meant for
+        // level unloads and other points where many entities are gone for
+        // good.
+        size_t compact();
+
+        // The bytes compact would release from the component storage, not
+        // counting sparse pages and entity slots. Storage that is growing is
+        // within its growth slack, so only storage that shrank counts.
+        size_t getUnusedBytes() const;
+
+        // Makes update compact the coordinator once the unused bytes of the
+        // component storage exceed the budget. A budget of 0 turns it off.
+        void setCompactBudget(size_t bytes) { compactBudget = bytes; }
+
         ////////////////////////////////////////////////////////////////////////
         // General
         ////////////////////////////////////////////////////////////////////////
@@ -330,83 +1898,259 @@ template <typename TComponent, typename ...TArgs>
 void Coordinator::addComponent(Entity entity, TArgs &&...args) {
     const auto componentId = Component<TComponent>::getId();
 
-    const auto entityId = entity.getId();
-
-    // Resize the component pools vector if necessary to accomodate component 
-    if (componentId >= componentPools.size()) {
-        componentPools.resize(componentId + 1, nullptr);
+    // Ignore stale handles, the slot may belong to another entity by now
+    if (!isAlive(entity)) {
+        spdlog::debug("Ignored adding component {} to stale entity {}", Component<TComponent>::getName(), entity.getId());
+        return;
     }
- 
-    // Add a new component pool to component pools vector if necessary
-    if (!componentPools[componentId]) {
-        std::shared_ptr<Pool<TComponent>> componentPool = std::make_shared<Pool<TComponent>>();
-        componentPools[componentId] = componentPool;
+
+    if (storageBackend == StorageBackend::Archetypes) {
+        // Move the entity into the archetype of its new signature
+        archetypes.add<TComponent>(entity, std::forward<TArgs>(args)...);
+        setComponentBit(entity, componentId, true);
+        return;
     }
 
-    spdlog::info("add new component pool");
+    if constexpr (isTagComponent<TComponent>) {
+        // Tags are only stored in the entity's component signature
+        setComponentBit(entity, componentId, true);
+    } else {
+        // Get the component pool, adding it if necessary
+        auto componentPool = assurePool<TComponent>();
+
+        // Construct the component in the component pool
+        componentPool->emplace(entity, getChangeTick(), std::forward<TArgs>(args)...);
+
+        // Set this component bit in entity's component signature
+        setComponentBit(entity, componentId, true);
 
-    // Get the component pool
-    std::shared_ptr<Pool<TComponent>> componentPool = std::static_pointer_cast<Pool<TComponent>>(componentPools[componentId]);
+        // Move the entity into the owning groups it now completes
+        addToOwningGroups(entity, componentId);
 
-    // Create a new component
-    TComponent newComponent(std::forward<TArgs>(args)...);
+        spdlog::debug("Added component {} to entity {}", Component<TComponent>::getName(), entity.getId());
+    }
+}
+
+template <typename ...TComponents, typename TEntities, typename TGenerator>
+void Coordinator::addComponents(const TEntities &entities, TGenerator generator) {
+    if (storageBackend == StorageBackend::Archetypes) {
+        // Moving between archetypes is per component anyway
+        for (auto entity : entities) {
+            if (!isAlive(entity)) {
+                continue;
+            }
+            auto components = generator(entity);
+            (addComponent<TComponents>(entity, std::get<TComponents>(std::move(components))), ...);
+        }
+        return;
+    }
 
+    constexpr auto componentBits = getComponentSignature<TComponents...>();
+    const auto tick = getChangeTick();
+
+    // Grow every pool once
+    auto reservePool = [&](auto *pool) {
+        pool->reserve(pool->getSize() + static_cast<int>(entities.getSize()));
+        return pool;
+    };
+    const auto pools = std::make_tuple(
+        [&]() {
+            if constexpr (isTagComponent<TComponents>) {
+                return nullptr;
+            } else {
+                return reservePool(assurePool<TComponents>());
+            }
+        }()...
+    );
 
-    // Add entity-component relationship into component pool
-    componentPool->set(entityId, newComponent);
+    for (auto entity : entities) {
+        // Ignore stale handles, the slot may belong to another entity by now
+        if (!isAlive(entity)) {
+            continue;
+        }
+        auto components = generator(entity);
+        std::apply([&](auto ...pool) {
+            ([&]() {
+                if constexpr (!isTagComponent<TComponents>) {
+                    pool->emplace(entity, tick, std::get<TComponents>(std::move(components)));
+                }
+            }(), ...);
+        }, pools);
+        addComponentBits(entity, componentBits);
+        if (!owningGroups.empty()) {
+            addToOwningGroups(entity, componentBits);
+        }
+    }
 
-    // Set this component bit in entity's component signature
-    entityComponentSignatures[entityId].set(componentId, true);
+    spdlog::debug("Added {} components to {} entities", sizeof...(TComponents), entities.getSize());
+}
 
-    spdlog::info("set component siganture");
+template <typename TComponent>
+void Coordinator::addComponentCopies(const EntityRange &entities, const TComponent &component) {
+    if (storageBackend == StorageBackend::Archetypes) {
+        for (auto entity : entities) {
+            addComponent<TComponent>(entity, component);
+        }
+    } else if constexpr (!isTagComponent<TComponent>) {
+        assurePool<TComponent>()->insertCopies(entities, component, getChangeTick());
+    }
 }
 
 template <typename TComponent>
 void Coordinator::removeComponent(Entity entity) {
-    const auto componentId = Component<TComponent>::getId();
-    const auto entityId = entity.getId();
-
-    // Do nothing if the component is not valid (not in component pools or is a nullptr)
-    if (componentId >= componentPools.size() || !componentPools[componentId]) {
+    // Ignore stale handles, the slot may belong to another entity by now
+    if (!isAlive(entity)) {
         return;
     }
 
-    // Remove the entity from the component pool
-    std::shared_ptr<TComponent> componentPool = std::static_pointer_cast<Pool<TComponent>>(componentPools[componentId]);
-    componentPool->remove(entityId);
+    if (storageBackend == StorageBackend::Archetypes) {
+        archetypes.remove<TComponent>(entity);
+    } else if constexpr (!isTagComponent<TComponent>) {
+        // Do nothing if the component is not valid (not in component pools or is a nullptr)
+        auto componentPool = getPool<TComponent>();
+        if (!componentPool) {
+            return;
+        }
+
+        // Move the entity out of its owning groups, then remove it from the
+        // component pool
+        removeFromOwningGroups(entity, getComponentSignature<TComponent>());
+        componentPool->remove(entity);
+    }
 
     // Unset this component bit in entity's component signature
-    entityComponentSignatures[entityId].set(componentId, false);
+    setComponentBit(entity, Component<TComponent>::getId(), false);
 }
 
 template <typename TComponent>
 bool Coordinator::hasComponent(Entity entity) const {
     const auto componentId = Component<TComponent>::getId();
-    const auto entityId = entity.getId();
-    return entityComponentSignatures[entityId].test(componentId);
+    // Stale handles and entities a command buffer did not create yet have
+    // no components
+    return isAlive(entity) && entityComponentSignatures[entity.getIndex()].test(componentId);
 }
 
 template <typename TComponent>
 TComponent &Coordinator::getComponent(Entity entity) const {
     // FIXME: We are assuming that an entity will have the component here!
+    if constexpr (isTagComponent<TComponent>) {
+        return getTagInstance<TComponent>();
+    } else if (storageBackend == StorageBackend::Archetypes) {
+        return archetypes.get<TComponent>(entity);
+    } else {
+        return getPool<TComponent>()->get(entity);
+    }
+}
 
-    const auto componentId = Component<TComponent>::getId();
-    const auto entityId = entity.getId();
-    std::shared_ptr<Pool<TComponent>> componentPool = std::static_pointer_cast<Pool<TComponent>>(componentPools[componentId]);
-    return componentPool->get(entityId);
+template <typename TComponent>
+TComponent &Coordinator::getMutableComponent(Entity entity) {
+    if constexpr (isTagComponent<TComponent>) {
+        return getTagInstance<TComponent>();
+    } else if (storageBackend == StorageBackend::Archetypes) {
+        return archetypes.get<TComponent>(entity);
+    } else {
+        auto componentPool = getPool<TComponent>();
+        componentPool->markChanged(entity, getChangeTick());
+        return componentPool->get(entity);
+    }
+}
+
+template <typename ...TComponents, typename ...TExcluded>
+View<TComponents...> Coordinator::view(Exclude<TExcluded...>) const {
+    auto view = storageBackend == StorageBackend::Archetypes
+        ? View<TComponents...>(&archetypes)
+        : View<TComponents...>(getPool<typename ViewComponent<TComponents>::Type>()...);
+    view.sinceTick = getRunningSystemLastRunTick();
+    view.excluded = getComponentSignature<TExcluded..., Disabled>();
+    // The signatures are only checked if there is something to filter out
+    if (sizeof...(TExcluded) > 0 || View<TComponents...>::HAS_TAGS || disabledEntityCount > 0) {
+        view.signatures = entityComponentSignatures.data();
+    }
+    return view;
+}
+
+template <typename TComponent>
+Pool<TComponent> *Coordinator::getPool() const {
+    return static_cast<Pool<TComponent> *>(componentPools[Component<TComponent>::getId()].get());
+}
+
+template <typename TComponent>
+Pool<TComponent> *Coordinator::assurePool() {
+    static_assert(!isTagComponent<TComponent>, "Tags are not stored in pools");
+    auto &componentPool = componentPools[Component<TComponent>::getId()];
+    if (!componentPool) {
+        componentPool = std::make_unique<Pool<TComponent>>();
+        spdlog::debug("Added component pool {}", Component<TComponent>::getName());
+    }
+    return static_cast<Pool<TComponent> *>(componentPool.get());
+}
+
+template <typename ...TOwned, typename ...TObserved>
+OwningGroup<Observe<TObserved...>, TOwned...> Coordinator::owningGroup(Observe<TObserved...>) {
+    static_assert(sizeof...(TOwned) > 0, "An owning group must own at least one component");
+    static_assert(!(isTagComponent<TOwned> || ...) && !(isTagComponent<TObserved> || ...), "Tags can not be part of an owning group");
+
+    if (storageBackend == StorageBackend::Archetypes) {
+        return OwningGroup<Observe<TObserved...>, TOwned...>(&archetypes);
+    }
+
+    constexpr auto ownedSignature = getComponentSignature<TOwned...>();
+    constexpr auto signature = getComponentSignature<TOwned..., TObserved...>();
+
+    OwningGroupData *group = nullptr;
+    for (auto &existingGroup : owningGroups) {
+        if (existingGroup->getOwnedSignature() == ownedSignature && existingGroup->getSignature() == signature) {
+            group = existingGroup.get();
+            break;
+        }
+    }
+
+    if (!group) {
+        // Two groups sorting the same pool would undo each other's swaps
+        if (ownedComponents.intersects(ownedSignature)) {
+            throw std::logic_error("A component pool can only be owned by one group, observe the component instead");
+        }
+        ownedComponents |= ownedSignature;
+
+        owningGroups.push_back(std::make_unique<OwningGroupData>(
+            ownedSignature, signature, std::vector<IPool *>{ assurePool<TOwned>()... }
+        ));
+        group = owningGroups.back().get();
+        (assurePool<TObserved>(), ...);
+
+        // Move the existing entities into the group
+        const auto &candidates = getPool<std::tuple_element_t<0, std::tuple<TOwned...>>>()->getEntities();
+        for (const auto entity : std::vector<Entity>(candidates.begin(), candidates.end())) {
+            group->onComponentAdded(entity, entityComponentSignatures[entity.getIndex()]);
+        }
+    }
+
+    return OwningGroup<Observe<TObserved...>, TOwned...>(group, getPool<TOwned>()..., getPool<TObserved>()...);
 }
 
 template <typename TSystem, typename ...TArgs>
 void Coordinator::addSystem(TArgs &&...args) {
     // NOTE: A system can be added multiple times, but will replace the old one
     std::shared_ptr<TSystem> newSystem = std::make_shared<TSystem>(std::forward<TArgs>(args)...);
-    systems.insert(std::make_pair(std::type_index(typeid(TSystem)), newSystem));
+
+    // Entities that already exist are added to the system right away
+    addEntitiesToSystem(*newSystem);
+
+    auto &system = systems[std::type_index(typeid(TSystem))];
+    auto systemInOrder = std::find(systemsInOrder.begin(), systemsInOrder.end(), system);
+    if (system && systemInOrder != systemsInOrder.end()) {
+        *systemInOrder = newSystem;
+    } else {
+        systemsInOrder.push_back(newSystem);
+    }
+    system = newSystem;
 }
 
 template <typename TSystem>
 void Coordinator::removeSystem() {
     auto system = systems.find(std::type_index(typeid(TSystem)));
     if (system != systems.end()) {
+        systemsInOrder.erase(std::find(systemsInOrder.begin(), systemsInOrder.end(), system->second));
         systems.erase(system);
     }
 }
@@ -423,9 +2167,225 @@ TSystem &Coordinator::getSystem() const {
     return *(std::static_pointer_cast<TSystem>(system->second));
 }
 
+template <typename TSystem>
+void Coordinator::enableSystem() {
+    getSystem<TSystem>().setEnabled(true);
+}
+
+template <typename TSystem>
+void Coordinator::disableSystem() {
+    getSystem<TSystem>().setEnabled(false);
+}
+
+template <typename TComponent, typename ...TArgs>
+void CommandBuffer::addComponent(Entity entity, TArgs &&...args) {
+    static_assert(alignof(TComponent) <= alignof(std::max_align_t), "Component alignment exceeds the arena alignment");
+
+    auto component = new (allocate(sizeof(TComponent), alignof(TComponent))) TComponent(std::forward<TArgs>(args)...);
+    commands.push_back({
+        CommandType::AddComponent,
+        entity,
+        component,
+        [](Coordinator &coordinator, Entity entity, void *component) {
+            coordinator.addComponent<TComponent>(entity, std::move(*static_cast<TComponent *>(component)));
+        },
+        [](void *component) {
+            static_cast<TComponent *>(component)->~TComponent();
+        }
+    });
+}
+
+template <typename TComponent>
+void CommandBuffer::removeComponent(Entity entity) {
+    commands.push_back({
+        CommandType::RemoveComponent,
+        entity,
+        nullptr,
+        [](Coordinator &coordinator, Entity entity, void *) {
+            coordinator.removeComponent<TComponent>(entity);
+        },
+        nullptr
+    });
+}
+
+template <typename TComponent>
+void ArchetypeStorage::registerComponent() {
+    const auto componentId = Component<TComponent>::getId();
+    if (componentId >= componentInfos.size()) {
+        componentInfos.resize(componentId + 1);
+    }
+    if (!componentInfos[componentId].size) {
+        componentInfos[componentId] = ComponentInfo::of<TComponent>();
+    }
+}
+
+template <typename TComponent, typename ...TArgs>
+void ArchetypeStorage::add(Entity entity, TArgs &&...args) {
+    const auto componentId = Component<TComponent>::getId();
+
+    if (entity.getIndex() >= locations.size()) {
+        locations.resize(entity.getIndex() + 1);
+    }
+    auto &location = locations[entity.getIndex()];
+
+    // Tags are part of the archetype signature, but have no column
+    if constexpr (isTagComponent<TComponent>) {
+        if (!has<TComponent>(entity)) {
+            move(entity, getArchetypeWith(location.archetype, componentId));
+        }
+        return;
+    }
+
+    // If the entity already has the component, simply replace it
+    registerComponent<TComponent>();
+    if (location.archetype && location.archetype->hasColumn(componentId)) {
+        auto &component = *static_cast<TComponent *>(location.archetype->getComponent(location.row, componentId));
+        component = TComponent(std::forward<TArgs>(args)...);
+        return;
+    }
+
+    move(entity, getArchetypeWith(location.archetype, componentId));
+    new (location.archetype->getComponent(location.row, componentId)) TComponent(std::forward<TArgs>(args)...);
+}
+
+template <typename TComponent>
+void ArchetypeStorage::remove(Entity entity) {
+    const auto componentId = Component<TComponent>::getId();
+    if (!has<TComponent>(entity)) {
+        return;
+    }
+    move(entity, getArchetypeWithout(locations[entity.getIndex()].archetype, componentId));
+}
+
+template <typename TComponent>
+bool ArchetypeStorage::has(Entity entity) const {
+    return (
+        entity.getIndex() < locations.size()
+        &&
+        locations[entity.getIndex()].archetype
+        &&
+        locations[entity.getIndex()].archetype->getSignature().test(Component<TComponent>::getId())
+    );
+}
+
+template <typename TComponent>
+TComponent &ArchetypeStorage::get(Entity entity) const {
+    if constexpr (isTagComponent<TComponent>) {
+        return getTagInstance<TComponent>();
+    }
+    const auto &location = locations[entity.getIndex()];
+    return *static_cast<TComponent *>(location.archetype->getComponent(location.row, Component<TComponent>::getId()));
+}
+
+template <typename ...TComponents>
+std::vector<const Archetype *> ArchetypeStorage::getMatchingArchetypes(const ComponentSignature &excluded) const {
+    constexpr auto mask = getRequiredSignature<TComponents...>();
+
+    std::vector<const Archetype *> matchingArchetypes;
+    for (auto archetype : archetypes) {
+        if (archetype->getSignature().contains(mask) && !archetype->getSignature().intersects(excluded)) {
+            matchingArchetypes.push_back(archetype);
+        }
+    }
+    return matchingArchetypes;
+}
+
+template <typename ...TComponents, typename TFunction>
+void ArchetypeStorage::eachInChunk(const Archetype &archetype, size_t chunk, TFunction &function) {
+    const auto count = archetype.getChunkSize(chunk);
+    const auto entities = archetype.getEntities(chunk);
+    // Optional components the archetype does not have get a null column
+    auto columns = std::make_tuple(static_cast<typename ViewComponent<TComponents>::Type *>(
+        archetype.hasColumn(Component<typename ViewComponent<TComponents>::Type>::getId())
+            ? archetype.getColumn(chunk, Component<typename ViewComponent<TComponents>::Type>::getId())
+            : nullptr
+    )...);
+    for (size_t i = 0; i < count; i++) {
+        std::apply([&](auto *...column) {
+            if constexpr (std::is_invocable_v<TFunction, Entity, typename ViewComponent<TComponents>::Argument...>) {
+                function(entities[i], getArgument<TComponents>(archetype, column, i)...);
+            } else {
+                function(getArgument<TComponents>(archetype, column, i)...);
+            }
+        }, columns);
+    }
+}
+
+template <typename ...TComponents, typename TFunction>
+void ArchetypeStorage::each(TFunction function, const ComponentSignature &excluded) const {
+    for (auto archetype : getMatchingArchetypes<TComponents...>(excluded)) {
+        for (size_t chunk = 0; chunk < archetype->getChunkCount(); chunk++) {
+            eachInChunk<TComponents...>(*archetype, chunk, function);
+        }
+    }
+}
+
+template <typename ...TComponents, typename TFunction>
+void ArchetypeStorage::parallelEach(ThreadPool &threadPool, TFunction function, size_t grainSize, const ComponentSignature &excluded) const {
+    JobCounter pendingBatches(0);
+    for (auto archetype : getMatchingArchetypes<TComponents...>(excluded)) {
+        // Every batch covers whole chunks, so batches never share a cache line
+        const auto chunksPerBatch = std::max<size_t>(1, grainSize / archetype->getChunkCapacity());
+        for (size_t first = 0; first < archetype->getChunkCount(); first += chunksPerBatch) {
+            const auto last = std::min(first + chunksPerBatch, archetype->getChunkCount());
+            threadPool.submit([archetype, first, last, &function]() {
+                for (size_t chunk = first; chunk < last; chunk++) {
+                    eachInChunk<TComponents...>(*archetype, chunk, function);
+                }
+            }, pendingBatches);
+        }
+    }
+    threadPool.wait(pendingBatches);
+}
+
 template <typename TComponent>
 void System::requireComponent() {
     componentSignature.set(Component<TComponent>::getId());
 }
 
+template <typename TComponent>
+void System::excludeComponent() {
+    excludeSignature.set(Component<TComponent>::getId());
+}
+
+template <typename TComponent>
+void System::readComponent() {
+    readSignature.set(Component<TComponent>::getId());
+    hasDeclaredAccess = true;
+}
+
+template <typename TComponent>
+void System::writeComponent() {
+    writeSignature.set(Component<TComponent>::getId());
+    hasDeclaredAccess = true;
+}
+
+template <typename TComponent, typename ...TArgs>
+Prefab &Prefab::addComponent(TArgs &&...args) {
+    static_assert(std::is_copy_constructible_v<TComponent>, "Prefab components must be copyable");
+
+    const auto componentId = Component<TComponent>::getId();
+    PrefabComponent prefabComponent = {
+        componentId,
+        std::make_shared<const TComponent>(std::forward<TArgs>(args)...),
+        [](Coordinator &coordinator, const void *component, const EntityRange &entities) {
+            coordinator.addComponentCopies<TComponent>(entities, *static_cast<const TComponent *>(component));
+        }
+    };
+
+    if (signature.test(componentId)) {
+        // Replace the old value, the components are kept in the order they
+        // were first added in
+        for (size_t i = 0; i < components.size(); i++) {
+            if (components[i].componentId == componentId) {
+                components[i] = std::move(prefabComponent);
+            }
+        }
+    } else {
+        signature.set(componentId);
+        components.push_back(std::move(prefabComponent));
+    }
+    return *this;
+}
+
 #endif
\ No newline at end of file
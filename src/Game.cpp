@@ -7,6 +7,8 @@
 #include <glm/glm.hpp>
 #include <spdlog/spdlog.h>
 
+static constexpr TagKey PLAYER_TAG = "player";
+
 Game::Game() {
     running = false;
     debugging = false;
@@ -63,10 +65,12 @@ void Game::initialize() {
 
 void Game::setup() {
     // Add systems
-    coordinator->addSystem<PhysicsSystem>();
+    coordinator->addSystem<PhysicsSystem>(*coordinator);
  
+    playerTag = coordinator->getTagId(PLAYER_TAG);
+
     Entity player = coordinator->create();
-    coordinator->tagEntity(player, "player");
+    coordinator->tagEntity(player, playerTag);
 
     coordinator->addComponent<TransformComponent>(
         player,
@@ -146,7 +150,7 @@ void Game::update(double deltaTime) {
     coordinator->update();
     
     // Update all systems
-    coordinator->getSystem<PhysicsSystem>().update(coordinator, deltaTime);
+    coordinator->updateSystems(deltaTime);
 }
 
 void Game::render() {
@@ -155,9 +159,11 @@ void Game::render() {
 
     SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
 
-    const auto &transform = coordinator->getComponent<TransformComponent>(Entity(0));
-    SDL_Rect player = { static_cast<int>(transform.position.x), static_cast<int>(transform.position.y), 32, 32};
-    SDL_RenderFillRect(renderer, &player);
+    if (auto playerEntity = coordinator->getEntityByTag(playerTag)) {
+        const auto &transform = coordinator->getComponent<TransformComponent>(*playerEntity);
+        SDL_Rect player = { static_cast<int>(transform.position.x), static_cast<int>(transform.position.y), 32, 32};
+        SDL_RenderFillRect(renderer, &player);
+    }
 
     SDL_RenderPresent(renderer);
 }
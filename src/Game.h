@@ -18,6 +18,7 @@ class Game {
         SDL_Renderer *renderer;
 
         std::unique_ptr<Coordinator> coordinator;
+        TagId playerTag;
 
     public:
         Game();
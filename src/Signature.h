@@ -0,0 +1,243 @@
+#ifndef SIGNATURE_H
+#define SIGNATURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Signature
+////////////////////////////////////////////////////////////////////////////////
+// A fixed size bitset stored as an aligned array of 64-bit words.
+// Unlike std::bitset the words are directly accessible, which lets subset
+// tests run as a few vector instructions: AVX2 when compiled with -mavx2,
+// SSE2 on any x86-64 target and a scalar loop everywhere else. Signatures of
+// a single word always use the scalar path, which is as cheap as the
+// std::bitset it replaces.
+// [ Bits = 64, 128, 256, ..., 1024 ]
+////////////////////////////////////////////////////////////////////////////////
+template <size_t Bits>
+class Signature {
+    static_assert(Bits > 0 && Bits % 64 == 0, "Signature size must be a multiple of 64 bits");
+
+    public:
+        static constexpr size_t WORD_BITS = 64;
+        static constexpr size_t WORD_COUNT = Bits / WORD_BITS;
+        static constexpr size_t ALIGNMENT = WORD_COUNT >= 4 ? 32 : WORD_COUNT >= 2 ? 16 : 8;
+
+    private:
+        alignas(ALIGNMENT) uint64_t words[WORD_COUNT] = {};
+
+    public:
+        constexpr Signature() = default;
+
+        static constexpr size_t size() { return Bits; }
+
+        ////////////////////////////////////////////////////////////////////////
+        // Bit access
+        ////////////////////////////////////////////////////////////////////////
+        constexpr bool test(size_t bit) const {
+            return (words[bit / WORD_BITS] >> (bit % WORD_BITS)) & 1;
+        }
+
+        constexpr Signature &set(size_t bit, bool value = true) {
+            const uint64_t mask = uint64_t(1) << (bit % WORD_BITS);
+            if (value) {
+                words[bit / WORD_BITS] |= mask;
+            } else {
+                words[bit / WORD_BITS] &= ~mask;
+            }
+            return *this;
+        }
+
+        constexpr Signature &reset(size_t bit) {
+            return set(bit, false);
+        }
+
+        constexpr Signature &reset() {
+            for (size_t i = 0; i < WORD_COUNT; i++) {
+                words[i] = 0;
+            }
+            return *this;
+        }
+
+        constexpr uint64_t getWord(size_t word) const { return words[word]; }
+        const uint64_t *getWords() const { return words; }
+
+        ////////////////////////////////////////////////////////////////////////
+        // Queries
+        ////////////////////////////////////////////////////////////////////////
+        bool none() const {
+            uint64_t bits = 0;
+            for (size_t i = 0; i < WORD_COUNT; i++) {
+                bits |= words[i];
+            }
+            return bits == 0;
+        }
+
+        bool any() const {
+            return !none();
+        }
+
+        size_t count() const {
+            size_t bits = 0;
+            for (size_t i = 0; i < WORD_COUNT; i++) {
+                bits += __builtin_popcountll(words[i]);
+            }
+            return bits;
+        }
+
+        // Checks if every bit of the mask is also set in this signature,
+        // the same as (*this & mask) == mask
+        bool contains(const Signature &mask) const {
+#if defined(__AVX2__)
+            if constexpr (WORD_COUNT % 4 == 0) {
+                for (size_t i = 0; i < WORD_COUNT; i += 4) {
+                    const auto bits = _mm256_load_si256(reinterpret_cast<const __m256i *>(words + i));
+                    const auto maskBits = _mm256_load_si256(reinterpret_cast<const __m256i *>(mask.words + i));
+                    // Carry flag is set when (~bits & maskBits) == 0
+                    if (!_mm256_testc_si256(bits, maskBits)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__)
+            if constexpr (WORD_COUNT % 2 == 0) {
+                auto missing = _mm_setzero_si128();
+                for (size_t i = 0; i < WORD_COUNT; i += 2) {
+                    const auto bits = _mm_load_si128(reinterpret_cast<const __m128i *>(words + i));
+                    const auto maskBits = _mm_load_si128(reinterpret_cast<const __m128i *>(mask.words + i));
+                    missing = _mm_or_si128(missing, _mm_andnot_si128(bits, maskBits));
+                }
+                return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) == 0xFFFF;
+            }
+#endif
+            uint64_t missing = 0;
+            for (size_t i = 0; i < WORD_COUNT; i++) {
+                missing |= mask.words[i] & ~words[i];
+            }
+            return missing == 0;
+        }
+
+        // Checks if this signature and the other have any bit in common
+        bool intersects(const Signature &other) const {
+            uint64_t common = 0;
+            for (size_t i = 0; i < WORD_COUNT; i++) {
+                common |= words[i] & other.words[i];
+            }
+            return common != 0;
+        }
+
+        // Calls the function with the position of every set bit, in order
+        template <typename TFunction>
+        void forEach(TFunction &&function) const {
+            for (size_t i = 0; i < WORD_COUNT; i++) {
+                for (uint64_t bits = words[i]; bits; bits &= bits - 1) {
+                    function(i * WORD_BITS + __builtin_ctzll(bits));
+                }
+            }
+        }
+
+        ////////////////////////////////////////////////////////////////////////
+        // Operators
+        ////////////////////////////////////////////////////////////////////////
+        constexpr Signature &operator &=(const Signature &other) {
+            for (size_t i = 0; i < WORD_COUNT; i++) {
+                words[i] &= other.words[i];
+            }
+            return *this;
+        }
+
+        constexpr Signature &operator |=(const Signature &other) {
+            for (size_t i = 0; i < WORD_COUNT; i++) {
+                words[i] |= other.words[i];
+            }
+            return *this;
+        }
+
+        constexpr Signature &operator ^=(const Signature &other) {
+            for (size_t i = 0; i < WORD_COUNT; i++) {
+                words[i] ^= other.words[i];
+            }
+            return *this;
+        }
+
+        constexpr Signature operator ~() const {
+            Signature result;
+            for (size_t i = 0; i < WORD_COUNT; i++) {
+                result.words[i] = ~words[i];
+            }
+            return result;
+        }
+
+        friend constexpr Signature operator &(Signature a, const Signature &b) { return a &= b; }
+        friend constexpr Signature operator |(Signature a, const Signature &b) { return a |= b; }
+        friend constexpr Signature operator ^(Signature a, const Signature &b) { return a ^= b; }
+
+        friend bool operator ==(const Signature &a, const Signature &b) {
+            uint64_t difference = 0;
+            for (size_t i = 0; i < WORD_COUNT; i++) {
+                difference |= a.words[i] ^ b.words[i];
+            }
+            return difference == 0;
+        }
+
+        friend bool operator !=(const Signature &a, const Signature &b) {
+            return !(a == b);
+        }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Bulk matching
+////////////////////////////////////////////////////////////////////////////////
+// Scans an array of signatures in a single pass and calls the function with
+// the index of every signature that contains the mask. The mask is loaded
+// into registers once, and single word signatures are tested four at a time
+// with AVX2.
+////////////////////////////////////////////////////////////////////////////////
+template <size_t Bits, typename TFunction>
+void forEachMatchingSignature(const Signature<Bits> *signatures, size_t count, const Signature<Bits> &mask, TFunction &&function) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    if constexpr (Signature<Bits>::WORD_COUNT == 1) {
+        const auto maskBits = _mm256_set1_epi64x(static_cast<long long>(mask.getWord(0)));
+        const auto zero = _mm256_setzero_si256();
+        for (; i + 4 <= count; i += 4) {
+            const auto bits = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(signatures[i].getWords()));
+            const auto missing = _mm256_andnot_si256(bits, maskBits);
+            auto matches = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(missing, zero))));
+            for (; matches; matches &= matches - 1) {
+                function(i + __builtin_ctz(matches));
+            }
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        if (signatures[i].contains(mask)) {
+            function(i);
+        }
+    }
+}
+
+namespace std {
+    template <size_t Bits>
+    struct hash<Signature<Bits>> {
+        size_t operator()(const Signature<Bits> &signature) const {
+            uint64_t hash = 14695981039346656037ull;
+            for (size_t i = 0; i < Signature<Bits>::WORD_COUNT; i++) {
+                hash = (hash ^ signature.getWord(i)) * 1099511628211ull;
+            }
+            return static_cast<size_t>(hash);
+        }
+    };
+}
+
+#endif
@@ -5,26 +5,35 @@
 #include "Components.h"
 
 class PhysicsSystem : public System {
+    private:
+        // Created on the main thread when the system is added, creating it in
+        // update would move pool entries while other systems run
+        OwningGroup<Observe<>, TransformComponent, RigidBodyComponent> bodies;
+
     public:
         double gravity;
 
-        PhysicsSystem(double gravity = 9.81) {
+        PhysicsSystem(Coordinator &coordinator, double gravity = 9.81)
+            : bodies(coordinator.owningGroup<TransformComponent, RigidBodyComponent>()) {
             this->gravity = 9.81;
 
             requireComponent<TransformComponent>();
             requireComponent<RigidBodyComponent>();
-        }
 
-        void update(std::unique_ptr<Coordinator> &coordinator, double deltaTime) {
-            for (auto entity : getSystemEntities()) {
-                auto &transform = coordinator->getComponent<TransformComponent>(entity);
-                const auto &rigidbody = coordinator->getComponent<RigidBodyComponent>(entity);
+            readComponent<RigidBodyComponent>();
+            writeComponent<TransformComponent>();
+        }
 
-                transform.position.x += rigidbody.velocity.x * deltaTime;
-                transform.position.y += rigidbody.velocity.y * deltaTime;
+        void update(Coordinator &coordinator, double deltaTime) override {
+            bodies.parallelEach(
+                coordinator.getThreadPool(),
+                [deltaTime](TransformComponent &transform, const RigidBodyComponent &rigidbody) {
+                    transform.position.x += rigidbody.velocity.x * deltaTime;
+                    transform.position.y += rigidbody.velocity.y * deltaTime;
 
-                spdlog::info("new position: " + std::to_string(transform.position.x) + " - " + std::to_string(transform.position.y));
-            }
+                    spdlog::info("new position: " + std::to_string(transform.position.x) + " - " + std::to_string(transform.position.y));
+                }
+            );
         }
 };
 
@@ -0,0 +1,80 @@
+#include "ThreadPool.h"
+
+static thread_local size_t currentThreadIndex = 0;
+
+ThreadPool::ThreadPool(size_t workerCount) {
+    stopping = false;
+
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(&ThreadPool::work, this, i + 1);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::getDefaultWorkerCount() {
+    const size_t hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+size_t ThreadPool::getCurrentThreadIndex() {
+    return currentThreadIndex;
+}
+
+void ThreadPool::submit(Job job, JobCounter &counter) {
+    counter.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back({ std::move(job), &counter });
+    }
+    condition.notify_one();
+}
+
+void ThreadPool::wait(JobCounter &counter) {
+    while (counter.load() > 0) {
+        if (!runPendingJob()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool ThreadPool::runPendingJob() {
+    PendingJob pendingJob;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (jobs.empty()) {
+            return false;
+        }
+        pendingJob = std::move(jobs.front());
+        jobs.pop_front();
+    }
+
+    pendingJob.job();
+    pendingJob.counter->fetch_sub(1);
+    return true;
+}
+
+void ThreadPool::work(size_t threadIndex) {
+    currentThreadIndex = threadIndex;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty()) {
+                return;
+            }
+        }
+        runPendingJob();
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+// Thread Pool
+////////////////////////////////////////////////////////////////////////////////
+// A Thread Pool runs jobs on a fixed number of worker threads. Every job is
+// tied to a counter that is decremented once the job finished, and a thread
+// waiting on a counter helps running pending jobs instead of blocking, so
+// jobs can safely submit and wait on other jobs.
+// [ Thread index 0 = any thread that is not a worker, e.g. the main thread ]
+////////////////////////////////////////////////////////////////////////////////
+using JobCounter = std::atomic<size_t>;
+
+const size_t CACHE_LINE_SIZE = 64;
+
+// The smallest number of indices that is worth handing to another thread
+const size_t DEFAULT_GRAIN_SIZE = 1024;
+
+class ThreadPool {
+    public:
+        using Job = std::function<void()>;
+
+    private:
+        struct PendingJob {
+            Job job;
+            JobCounter *counter;
+        };
+
+        std::vector<std::thread> workers;
+        std::deque<PendingJob> jobs;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping;
+
+        bool runPendingJob();
+        void work(size_t threadIndex);
+
+    public:
+        ThreadPool(size_t workerCount = getDefaultWorkerCount());
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator =(const ThreadPool &) = delete;
+
+        // One worker per hardware thread, leaving one for the main thread
+        static size_t getDefaultWorkerCount();
+        static size_t getCurrentThreadIndex();
+
+        size_t getWorkerCount() const { return workers.size(); }
+        size_t getThreadCount() const { return workers.size() + 1; }
+
+        void submit(Job job, JobCounter &counter);
+        void wait(JobCounter &counter);
+
+        // Splits [0, count) into ranges of at least grainSize indices and calls
+        // function(begin, end) for every range, using the calling thread and
+        // the workers. Blocks until every range has finished.
+        // NOTE: Range sizes are rounded up to a multiple of CACHE_LINE_SIZE
+        // indices, which is a multiple of CACHE_LINE_SIZE bytes for any
+        // element size. Ranges over an array that starts on a cache line,
+        // like the page aligned storage of a reserved pool, then never share
+        // a cache line. Arrays in a std::vector are not aligned like that, so
+        // neighbouring ranges can share the one cache line at their boundary.
+        template <typename TFunction> void parallelFor(size_t count, size_t grainSize, TFunction function);
+};
+
+template <typename TFunction>
+void ThreadPool::parallelFor(size_t count, size_t grainSize, TFunction function) {
+    // Aim for a few ranges per thread so uneven ranges still balance out
+    const size_t rangesPerThread = 4;
+    const size_t rangeCount = getThreadCount() * rangesPerThread;
+    size_t rangeSize = std::max<size_t>({ grainSize, (count + rangeCount - 1) / rangeCount, 1 });
+    rangeSize = (rangeSize + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+
+    if (rangeSize >= count) {
+        function(size_t(0), count);
+        return;
+    }
+
+    JobCounter pendingRanges(0);
+    for (size_t begin = rangeSize; begin < count; begin += rangeSize) {
+        const size_t end = std::min(begin + rangeSize, count);
+        submit([&function, begin, end]() { function(begin, end); }, pendingRanges);
+    }
+    function(size_t(0), rangeSize);
+    wait(pendingRanges);
+}
+
+#endif
@@ -0,0 +1,69 @@
+#include "VirtualMemory.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+size_t virtualMemory::getPageSize() {
+#if defined(_WIN32)
+    static const size_t pageSize = []() {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<size_t>(info.dwPageSize);
+    }();
+#else
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    return pageSize;
+}
+
+void *virtualMemory::reserve(size_t bytes) {
+#if defined(_WIN32)
+    void *address = VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_NOACCESS);
+    if (!address) {
+        throw std::bad_alloc();
+    }
+#else
+    void *address = mmap(nullptr, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (address == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+#endif
+    return address;
+}
+
+void virtualMemory::release(void *address, size_t bytes) {
+#if defined(_WIN32)
+    (void)bytes;
+    VirtualFree(address, 0, MEM_RELEASE);
+#else
+    munmap(address, bytes);
+#endif
+}
+
+void virtualMemory::commit(void *address, size_t bytes) {
+#if defined(_WIN32)
+    if (!VirtualAlloc(address, bytes, MEM_COMMIT, PAGE_READWRITE)) {
+        throw std::bad_alloc();
+    }
+#else
+    // The pages are backed by memory on first touch
+    if (mprotect(address, bytes, PROT_READ | PROT_WRITE) != 0) {
+        throw std::bad_alloc();
+    }
+#endif
+}
+
+void virtualMemory::decommit(void *address, size_t bytes) {
+#if defined(_WIN32)
+    VirtualFree(address, bytes, MEM_DECOMMIT);
+#else
+    madvise(address, bytes, MADV_DONTNEED);
+    mprotect(address, bytes, PROT_NONE);
+#endif
+}
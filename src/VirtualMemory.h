@@ -0,0 +1,200 @@
+#ifndef VIRTUALMEMORY_H
+#define VIRTUALMEMORY_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////
+// Virtual Memory
+////////////////////////////////////////////////////////////////////////////////
+// Thin wrappers around mmap/madvise and VirtualAlloc/VirtualFree. Reserving
+// only claims a range of addresses, the pages are backed by memory once they
+// are committed and touched, and go back to the OS when they are decommitted.
+////////////////////////////////////////////////////////////////////////////////
+namespace virtualMemory {
+    size_t getPageSize();
+
+    // Returns the start of the reserved range, throws std::bad_alloc if the
+    // range could not be reserved.
+    void *reserve(size_t bytes);
+    void release(void *address, size_t bytes);
+
+    // NOTE: The range must be page aligned and inside a reserved range.
+    void commit(void *address, size_t bytes);
+    void decommit(void *address, size_t bytes);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Virtual Vector
+////////////////////////////////////////////////////////////////////////////////
+// A vector that reserves the address range for MaxSize objects up front and
+// commits pages as it grows. Growing never moves the objects, so pointers and
+// references to them stay valid until the object is removed, and there is no
+// frame where the whole array is copied. shrink_to_fit gives the pages past
+// the last object back to the OS.
+// NOTE: Has the subset of the std::vector interface the ECS uses.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T, size_t MaxSize>
+class VirtualVector {
+    private:
+        T *objects;
+        size_t size_;
+        // Bytes at the start of the range that are committed
+        size_t committedBytes;
+
+        static size_t getReservedBytes() {
+            const auto pageSize = virtualMemory::getPageSize();
+            return (MaxSize * sizeof(T) + pageSize - 1) / pageSize * pageSize;
+        }
+
+        void assureCommitted(size_t n) {
+            const auto bytes = n * sizeof(T);
+            if (bytes <= committedBytes) {
+                return;
+            }
+            if (n > MaxSize) {
+                throw std::length_error("Virtual vector is full");
+            }
+            // Commit at least as much as is committed already, so that the
+            // number of commits stays logarithmic
+            const auto pageSize = virtualMemory::getPageSize();
+            auto newCommittedBytes = std::max(bytes, 2 * committedBytes);
+            newCommittedBytes = std::min((newCommittedBytes + pageSize - 1) / pageSize * pageSize, getReservedBytes());
+            virtualMemory::commit(reinterpret_cast<std::byte *>(objects) + committedBytes, newCommittedBytes - committedBytes);
+            committedBytes = newCommittedBytes;
+        }
+
+    public:
+        VirtualVector()
+            : objects(static_cast<T *>(virtualMemory::reserve(getReservedBytes()))), size_(0), committedBytes(0) {}
+
+        ~VirtualVector() {
+            clear();
+            virtualMemory::release(objects, getReservedBytes());
+        }
+
+        VirtualVector(const VirtualVector &) = delete;
+        VirtualVector &operator =(const VirtualVector &) = delete;
+
+        size_t size() const { return size_; }
+        size_t capacity() const { return committedBytes / sizeof(T); }
+        bool empty() const { return size_ == 0; }
+
+        // Commits the pages for n objects
+        void reserve(size_t n) {
+            assureCommitted(n);
+        }
+
+        template <typename ...TArgs>
+        T &emplace_back(TArgs &&...args) {
+            assureCommitted(size_ + 1);
+            auto object = new (objects + size_) T(std::forward<TArgs>(args)...);
+            size_++;
+            return *object;
+        }
+
+        void push_back(const T &object) { emplace_back(object); }
+        void push_back(T &&object) { emplace_back(std::move(object)); }
+
+        // Appends n copies of the value. Trivially copyable objects are copied
+        // with a doubling memcpy.
+        // NOTE: Only inserting at the end is supported.
+        T *insert(T *position, size_t n, const T &value) {
+            assert(position == end() && "Virtual vectors only insert at the end");
+            assureCommitted(size_ + n);
+            if constexpr (std::is_trivially_copyable_v<T>) {
+                if (n > 0) {
+                    std::memcpy(static_cast<void *>(position), &value, sizeof(T));
+                    for (size_t copied = 1; copied < n; copied *= 2) {
+                        std::memcpy(static_cast<void *>(position + copied), position, std::min(copied, n - copied) * sizeof(T));
+                    }
+                    size_ += n;
+                }
+            } else {
+                for (size_t i = 0; i < n; i++) {
+                    emplace_back(value);
+                }
+            }
+            return position;
+        }
+
+        void pop_back() {
+            objects[--size_].~T();
+        }
+
+        void resize(size_t n) {
+            assureCommitted(n);
+            while (size_ < n) {
+                emplace_back();
+            }
+            while (size_ > n) {
+                pop_back();
+            }
+        }
+
+        // Removes the objects in [first, last), moving the following objects
+        // down.
+        T *erase(T *first, T *last) {
+            const auto end = objects + size_;
+            const auto newEnd = std::move(last, end, first);
+            while (objects + size_ > newEnd) {
+                pop_back();
+            }
+            return first;
+        }
+
+        void clear() {
+            while (size_ > 0) {
+                pop_back();
+            }
+        }
+
+        // The committed bytes in the pages past the first n objects
+        size_t getCommittedBytesPast(size_t n) const {
+            const auto pageSize = virtualMemory::getPageSize();
+            const auto keptBytes = (n * sizeof(T) + pageSize - 1) / pageSize * pageSize;
+            return keptBytes < committedBytes ? committedBytes - keptBytes : 0;
+        }
+
+        // Decommits the pages past the first n objects, which must not be
+        // fewer than the size. Returns the number of bytes given back to the
+        // OS.
+        size_t decommitPast(size_t n) {
+            assert(n >= size_ && "Can not decommit the pages of objects");
+            const auto releasedBytes = getCommittedBytesPast(n);
+            if (releasedBytes == 0) {
+                return 0;
+            }
+            committedBytes -= releasedBytes;
+            virtualMemory::decommit(reinterpret_cast<std::byte *>(objects) + committedBytes, releasedBytes);
+            return releasedBytes;
+        }
+
+        // Decommits the pages past the last object. Returns the number of
+        // bytes given back to the OS.
+        size_t shrink_to_fit() {
+            return decommitPast(size_);
+        }
+
+        T *data() { return objects; }
+        const T *data() const { return objects; }
+
+        T &operator [](size_t index) { return objects[index]; }
+        const T &operator [](size_t index) const { return objects[index]; }
+
+        T &back() { return objects[size_ - 1]; }
+        const T &back() const { return objects[size_ - 1]; }
+
+        T *begin() { return objects; }
+        T *end() { return objects + size_; }
+        const T *begin() const { return objects; }
+        const T *end() const { return objects + size_; }
+};
+
+#endif